@@ -2,6 +2,7 @@
 
 #include <libpayload.h>
 
+#include "base/cleanup_funcs.h"
 #include "base/elog.h"
 #include "drivers/flash/flash.h"
 
@@ -45,6 +46,12 @@ static struct elog_state elog_state;
 #define ELOG_SIZE (4 * KiB)
 static uint8_t elog_mirror_buf[ELOG_SIZE];
 
+/*
+ * With ELOG_WRITE_BACK, new events are written to flash once this many
+ * bytes of them are waiting.
+ */
+#define ELOG_WRITE_BACK_THRESHOLD 256
+
 static size_t elog_events_start(void)
 {
 	/* Events are added directly after the header. */
@@ -126,6 +133,27 @@ static int elog_update_event_buffer_state(size_t start_offset)
 	return 0;
 }
 
+static int elog_flush_cleanup(struct CleanupFunc *cleanup, CleanupType type)
+{
+	return elog_flush();
+}
+
+/* Make sure pending events reach the flash before depthcharge exits. */
+static void elog_install_flush(void)
+{
+	static CleanupFunc dev = {
+		.cleanup = &elog_flush_cleanup,
+		.types = CleanupOnReboot | CleanupOnPowerOff |
+			 CleanupOnHandoff | CleanupOnLegacy,
+	};
+	static bool installed;
+
+	if (installed)
+		return;
+	list_insert_after(&dev.list_node, &cleanup_funcs);
+	installed = true;
+}
+
 elog_error_t elog_init(void)
 {
 	FmapArea *area = &elog_state.nv_area;
@@ -166,6 +194,9 @@ elog_error_t elog_init(void)
 
 	elog_state.elog_initialized = ELOG_INIT_INITIALIZED;
 
+	if (CONFIG(ELOG_WRITE_BACK))
+		elog_install_flush();
+
 	return ELOG_ERR("ELOG context successfully initialized", ELOG_SUCCESS);
 }
 
@@ -186,6 +217,13 @@ static elog_error_t elog_sync_to_flash(void)
 	return ELOG_SUCCESS;
 }
 
+elog_error_t elog_flush(void)
+{
+	if (elog_state.elog_initialized != ELOG_INIT_INITIALIZED)
+		return ELOG_SUCCESS;
+	return elog_sync_to_flash();
+}
+
 elog_error_t elog_add_event_raw(uint8_t event_type, void *data,
 				uint8_t data_size)
 {
@@ -233,6 +271,12 @@ elog_error_t elog_add_event_raw(uint8_t event_type, void *data,
 	/* No need to shrink in depthcharge now since we have already checked it
 	   in coreboot and we only want to add one event now. */
 
+	/* Leave small updates for one write later on. */
+	if (CONFIG(ELOG_WRITE_BACK) &&
+	    elog_state.last_write - elog_state.nv_last_write <
+	    ELOG_WRITE_BACK_THRESHOLD)
+		return ELOG_SUCCESS;
+
 	/* Ensure the updates hit the non-volatile storage. */
 	return elog_sync_to_flash();
 }
@@ -26,5 +26,7 @@ typedef enum {
 elog_error_t elog_init(void);
 elog_error_t elog_add_event_raw(uint8_t event_type, void *data,
 				uint8_t data_size);
+/* Write any events still held in memory to flash. */
+elog_error_t elog_flush(void);
 
 #endif /* __BASE_ELOG_H__ */
@@ -33,9 +33,13 @@ enum timestamp_id {
 	TS_RW_VB_SELECT_AND_LOAD_KERNEL = 1010,
 
 	TS_VB_SELECT_AND_LOAD_KERNEL = 1020,
+	TS_VB_EC_HASH_WAIT_START = 1021,
+	TS_VB_EC_HASH_WAIT_END = 1022,
 	TS_VB_EC_VBOOT_DONE = 1030,
 	TS_VB_STORAGE_INIT_DONE = 1040,
 	TS_VB_READ_KERNEL_DONE = 1050,
+	TS_VB_AUXFW_UPDATE_START = 1055,
+	TS_VB_AUXFW_UPDATE_END = 1056,
 	TS_VB_AUXFW_SYNC_DONE = 1060,
 	TS_VB_VBOOT_DONE = 1100,
 
@@ -89,8 +89,7 @@ static void tpm_setup(void)
 				    &gsc_irq_status);
 	tpm_set_ops(&tpm->base.ops);
 	if (CONFIG(TPM_GOOGLE_SWITCHES))
-		flag_replace(FLAG_PHYS_PRESENCE,
-				&new_gsc_rec_switch(&tpm->base.ops)->ops);
+		flag_replace(FLAG_PHYS_PRESENCE, &new_gsc_rec_switch()->ops);
 }
 
 static int board_setup(void)
@@ -86,7 +86,7 @@ static void dedede_setup_tpm(void)
 		tpm_set_ops(&tpm->ops);
 		if (!CONFIG(PHYSICAL_PRESENCE_KEYBOARD)) {
 			flag_replace(FLAG_PHYS_PRESENCE,
-				     &new_gsc_rec_switch(&tpm->ops)->ops);
+				     &new_gsc_rec_switch()->ops);
 		}
 	}
 
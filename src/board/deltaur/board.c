@@ -113,7 +113,7 @@ static int board_setup(void)
 	GscI2c *tpm = new_gsc_i2c(&i2c3->ops, GSC_I2C_ADDR, &gsc_irq_status);
 	tpm_set_ops(&tpm->base.ops);
 
-	GpioOps *power_switch = &new_gsc_power_switch(&tpm->base.ops)->ops;
+	GpioOps *power_switch = &new_gsc_power_switch()->ops;
 	flag_replace(FLAG_PWRSW, power_switch);
 	flag_replace(FLAG_PHYS_PRESENCE, power_switch);
 
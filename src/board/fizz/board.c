@@ -60,7 +60,7 @@ static int gsc_irq_status(void)
 	return skylake_get_gpe(GPE0_DW2_00);
 }
 
-static TpmOps *fizz_setup_tpm(void)
+static void fizz_setup_tpm(void)
 {
 	if (CONFIG(DRIVER_TPM_SPI)) {
 		/* SPI TPM */
@@ -75,14 +75,12 @@ static TpmOps *fizz_setup_tpm(void)
 		SpiTpm *tpm = new_tpm_spi(new_intel_gspi(&gspi0_params),
 					  gsc_irq_status);
 		tpm_set_ops(&tpm->ops);
-		return &tpm->ops;
 	} else if (CONFIG(DRIVER_TPM_I2C)) {
 		DesignwareI2c *i2c1 = new_pci_designware_i2c(
 			PCI_DEV(0, 0x15, 1), 400000, SKYLAKE_DW_I2C_MHZ);
 		GscI2c *tpm = new_gsc_i2c(&i2c1->ops, GSC_I2C_ADDR,
 					    &gsc_irq_status);
 		tpm_set_ops(&tpm->base.ops);
-		return &tpm->base.ops;
 	}
 }
 
@@ -104,8 +102,8 @@ static int board_setup(void)
 	sysinfo_install_flags(new_skylake_gpio_input_from_coreboot);
 
 	/* TPM */
-	TpmOps *tpm_ops	= fizz_setup_tpm();
-	flag_replace(FLAG_PHYS_PRESENCE, &new_gsc_rec_switch(tpm_ops)->ops);
+	fizz_setup_tpm();
+	flag_replace(FLAG_PHYS_PRESENCE, &new_gsc_rec_switch()->ops);
 
 	/* Chrome EC (eSPI) */
 	CrosEcLpcBus *cros_ec_lpc_bus =
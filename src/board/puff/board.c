@@ -81,8 +81,7 @@ static void puff_setup_tpm(void)
 		SpiTpm *tpm = new_tpm_spi(new_intel_gspi(&gspi0_params),
 					  gsc_irq_status);
 		tpm_set_ops(&tpm->ops);
-		flag_replace(FLAG_PHYS_PRESENCE,
-			     &new_gsc_rec_switch(&tpm->ops)->ops);
+		flag_replace(FLAG_PHYS_PRESENCE, &new_gsc_rec_switch()->ops);
 	}
 }
 
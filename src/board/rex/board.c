@@ -86,8 +86,7 @@ static void tpm_setup(void)
 				    &gsc_irq_status);
 	tpm_set_ops(&tpm->base.ops);
 	if (CONFIG(TPM_GOOGLE_SWITCHES))
-		flag_replace(FLAG_PHYS_PRESENCE,
-				&new_gsc_rec_switch(&tpm->base.ops)->ops);
+		flag_replace(FLAG_PHYS_PRESENCE, &new_gsc_rec_switch()->ops);
 }
 
 __weak const struct audio_config *variant_probe_audio_config(void)
@@ -126,7 +126,7 @@ static int board_setup(void)
 	tpm = new_gsc_i2c(&i2c4->ops, GSC_I2C_ADDR, &gsc_irq_status);
 	tpm_set_ops(&tpm->base.ops);
 
-	power_switch = &new_gsc_power_switch(&tpm->base.ops)->ops;
+	power_switch = &new_gsc_power_switch()->ops;
 	flag_replace(FLAG_PWRSW, power_switch);
 	flag_replace(FLAG_PHYS_PRESENCE, power_switch);
 
@@ -63,7 +63,8 @@ static int do_enet(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		uip_ipaddr_t my_ip, next_ip, server_ip;
 		const char *dhcp_bootfile;
 
-		if (!try_dhcp(&my_ip, &next_ip, &server_ip, &dhcp_bootfile))
+		if (!try_dhcp(&my_ip, &next_ip, &server_ip, &dhcp_bootfile,
+			      NULL))
 			return CMD_RET_SUCCESS;
 
 	}
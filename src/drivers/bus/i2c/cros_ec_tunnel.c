@@ -146,10 +146,19 @@ static int ec_i2c_parse_response(const uint8_t *buf, I2cSeg *segments,
 	return 0;
 }
 
-static int i2c_transfer(I2cOps *me, I2cSeg *segments, int seg_count)
+/* Largest request the EC will take, as far as we know. */
+static int ec_i2c_request_max(CrosECTunnelI2c *bus)
 {
-	CrosECTunnelI2c *bus = container_of(me, CrosECTunnelI2c, ops);
+	int max_param_size = cros_ec_get()->max_param_size;
+
+	if (max_param_size)
+		return MIN(max_param_size, ARRAY_SIZE(bus->request_buf));
+	return ARRAY_SIZE(bus->request_buf);
+}
 
+static int ec_i2c_passthru(CrosECTunnelI2c *bus, I2cSeg *segments,
+			   int seg_count)
+{
 	int request_len;
 	int response_len;
 	int result;
@@ -157,7 +166,7 @@ static int i2c_transfer(I2cOps *me, I2cSeg *segments, int seg_count)
 	request_len = ec_i2c_count_message(segments, seg_count);
 	response_len = ec_i2c_count_response(segments, seg_count);
 
-	if (request_len > ARRAY_SIZE(bus->request_buf) ||
+	if (request_len > ec_i2c_request_max(bus) ||
 	    response_len > ARRAY_SIZE(bus->response_buf)) {
 		printf("%s: Request or response too large (%d/%d).\n",
 		       __func__, request_len, response_len);
@@ -183,6 +192,106 @@ static int i2c_transfer(I2cOps *me, I2cSeg *segments, int seg_count)
 	return 0;
 }
 
+int cros_ec_tunnel_i2c_flush(CrosECTunnelI2c *bus)
+{
+	int count = bus->batch_count;
+
+	if (!count)
+		return 0;
+
+	bus->batch_count = 0;
+	bus->batch_data_len = 0;
+	return ec_i2c_passthru(bus, bus->batch, count);
+}
+
+/* Whether segments can be added to the queue without overflowing it. */
+static int ec_i2c_batch_fits(CrosECTunnelI2c *bus, I2cSeg *segments,
+			     int seg_count, int data_len)
+{
+	int request_len, response_len;
+
+	if (bus->batch_count + seg_count > CROS_EC_TUNNEL_I2C_MAX_SEGS ||
+	    bus->batch_data_len + data_len > ARRAY_SIZE(bus->batch_data))
+		return 0;
+
+	request_len = ec_i2c_count_message(bus->batch, bus->batch_count) +
+		      ec_i2c_count_message(segments, seg_count) -
+		      sizeof(struct ec_params_i2c_passthru);
+	response_len = ec_i2c_count_response(bus->batch, bus->batch_count) +
+		       ec_i2c_count_response(segments, seg_count) -
+		       sizeof(struct ec_response_i2c_passthru);
+
+	return request_len <= ec_i2c_request_max(bus) &&
+	       response_len <= ARRAY_SIZE(bus->response_buf);
+}
+
+/* Bytes of write data in a transaction. */
+static int ec_i2c_count_write_data(I2cSeg *segments, int seg_count)
+{
+	int data_len = 0;
+	int i;
+
+	for (i = 0; i < seg_count; i++)
+		if (!segments[i].read)
+			data_len += segments[i].len;
+
+	return data_len;
+}
+
+int cros_ec_tunnel_i2c_batch(CrosECTunnelI2c *bus, I2cSeg *segments,
+			     int seg_count)
+{
+	int data_len = ec_i2c_count_write_data(segments, seg_count);
+	int i;
+
+	/* Send what's queued if this transaction won't fit alongside it. */
+	if (!ec_i2c_batch_fits(bus, segments, seg_count, data_len)) {
+		if (cros_ec_tunnel_i2c_flush(bus))
+			return -1;
+		if (!ec_i2c_batch_fits(bus, segments, seg_count, data_len)) {
+			printf("%s: Transaction too large.\n", __func__);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < seg_count; i++) {
+		I2cSeg *seg = &bus->batch[bus->batch_count++];
+
+		*seg = segments[i];
+		if (seg->read)
+			continue;
+		memcpy(&bus->batch_data[bus->batch_data_len], seg->buf,
+		       seg->len);
+		seg->buf = &bus->batch_data[bus->batch_data_len];
+		bus->batch_data_len += seg->len;
+	}
+
+	return 0;
+}
+
+static int i2c_transfer(I2cOps *me, I2cSeg *segments, int seg_count)
+{
+	CrosECTunnelI2c *bus = container_of(me, CrosECTunnelI2c, ops);
+	int data_len = ec_i2c_count_write_data(segments, seg_count);
+
+	/*
+	 * Keep anything queued in order with this transfer, sending both in
+	 * the same command when they fit. This lets drivers queue the writes
+	 * that set up an operation and have them go out with the first read
+	 * of its status.
+	 */
+	if (bus->batch_count &&
+	    ec_i2c_batch_fits(bus, segments, seg_count, data_len)) {
+		if (cros_ec_tunnel_i2c_batch(bus, segments, seg_count))
+			return -1;
+		return cros_ec_tunnel_i2c_flush(bus);
+	}
+	if (cros_ec_tunnel_i2c_flush(bus))
+		return -1;
+
+	return ec_i2c_passthru(bus, segments, seg_count);
+}
+
 int cros_ec_tunnel_i2c_protect(CrosECTunnelI2c *bus)
 {
 	return cros_ec_i2c_passthru_protect(bus->remote_bus);
@@ -17,12 +17,21 @@
 #include <assert.h>
 #include <stddef.h>
 
+#define CROS_EC_TUNNEL_I2C_MAX_SEGS 64
+
 typedef struct CrosECTunnelI2c {
 	I2cOps ops;
 	uint16_t remote_bus;
 
 	uint8_t request_buf[256];
 	uint8_t response_buf[256];
+
+	/* Transactions queued by cros_ec_tunnel_i2c_batch(). */
+	I2cSeg batch[CROS_EC_TUNNEL_I2C_MAX_SEGS];
+	int batch_count;
+	/* Copies of the queued write data. */
+	uint8_t batch_data[256];
+	int batch_data_len;
 } CrosECTunnelI2c;
 
 /* -----------------------------------------------------------------------
@@ -32,6 +41,25 @@ typedef struct CrosECTunnelI2c {
  */
 CrosECTunnelI2c *new_cros_ec_tunnel_i2c(uint16_t remote_bus);
 
+/* -----------------------------------------------------------------------
+ * Queue an I2C transaction to be sent together with others in as few
+ * EC_CMD_I2C_PASSTHRU commands as possible, instead of one command each.
+ * Transactions in the same command are separated by a repeated start
+ * rather than a stop. Write data is copied, but read segments are only
+ * filled in once the queue is flushed. That happens when the next
+ * transaction doesn't fit, along with the next ordinary transfer on the
+ * bus, and in cros_ec_tunnel_i2c_flush().
+ *   Returns: < 0 on error, 0 on success
+ */
+int cros_ec_tunnel_i2c_batch(CrosECTunnelI2c *bus, I2cSeg *segments,
+			     int seg_count);
+
+/* -----------------------------------------------------------------------
+ * Send any transactions queued by cros_ec_tunnel_i2c_batch().
+ *   Returns: < 0 on error, 0 on success
+ */
+int cros_ec_tunnel_i2c_flush(CrosECTunnelI2c *bus);
+
 /*------------------------------------------------------------------------
  * Protect all the TCPC I2C tunnels in EC
  *   Returns: < 0 on error, 0 on success
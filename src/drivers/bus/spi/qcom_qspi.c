@@ -213,11 +213,10 @@ int spi_stop(SpiOps *me)
 	return qspi->gpio_ops->set(qspi->gpio_ops, CS_DEASSERT);
 }
 
-int spi_xfer(SpiOps *me, void *in, const void *out, uint32_t size)
+static int spi_xfer_mode(QcomQspi *qspi_bus, void *in, const void *out,
+			 uint32_t size, QspiMode mode)
 {
-	QspiMode mode = SDR_1BIT;
 	uint8_t *data = (uint8_t *)(out ? out : in);
-	QcomQspi *qspi_bus = container_of(me, QcomQspi, ops);
 
 	/* Full duplex transfer is not supported */
 	if (in && out)
@@ -237,6 +236,28 @@ int spi_xfer(SpiOps *me, void *in, const void *out, uint32_t size)
 	return 0;
 }
 
+int spi_xfer(SpiOps *me, void *in, const void *out, uint32_t size)
+{
+	QcomQspi *qspi_bus = container_of(me, QcomQspi, ops);
+
+	return spi_xfer_mode(qspi_bus, in, out, size, SDR_1BIT);
+}
+
+static int spi_receive_wide(SpiOps *me, void *in, uint32_t size,
+			    unsigned int width)
+{
+	QcomQspi *qspi_bus = container_of(me, QcomQspi, ops);
+
+	switch (width) {
+	case 2:
+		return spi_xfer_mode(qspi_bus, in, NULL, size, SDR_2BIT);
+	case 4:
+		return spi_xfer_mode(qspi_bus, in, NULL, size, SDR_4BIT);
+	default:
+		return spi_xfer_mode(qspi_bus, in, NULL, size, SDR_1BIT);
+	}
+}
+
 QcomQspi *new_qcom_qspi(uintptr_t base, GpioOps *cs)
 {
 	QcomQspi *qspi_bus = xzalloc(sizeof(*qspi_bus));
@@ -244,6 +265,12 @@ QcomQspi *new_qcom_qspi(uintptr_t base, GpioOps *cs)
 	qspi_bus->ops.start = &spi_start;
 	qspi_bus->ops.stop  = &spi_stop;
 	qspi_bus->ops.transfer = &spi_xfer;
+	qspi_bus->ops.receive_wide = &spi_receive_wide;
+	/*
+	 * IO2 and IO3 aren't always wired up to the flash, so boards which
+	 * have them can raise this to 4.
+	 */
+	qspi_bus->ops.max_rx_width = 2;
 	qspi_bus->qspi_base = (QcomQspiRegs *)base;
 	qspi_bus->gpio_ops = cs;
 	return qspi_bus;
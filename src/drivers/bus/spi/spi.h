@@ -22,6 +22,15 @@ typedef struct SpiOps
 	int (*transfer)(struct SpiOps *me, void *in, const void *out,
 			uint32_t size);
 	int (*stop)(struct SpiOps *me);
+	/*
+	 * Optional: receive with the data coming in on 'width' (2 or 4)
+	 * lines, for the multi-I/O flash read commands. Controllers which
+	 * implement this set max_rx_width to the widest they and the board
+	 * wiring support.
+	 */
+	int (*receive_wide)(struct SpiOps *me, void *in, uint32_t size,
+			    unsigned int width);
+	unsigned int max_rx_width;
 } SpiOps;
 
 #endif /* __DRIVERS_BUS_SPI_SPI_H__ */
@@ -170,10 +170,28 @@ static int __must_check write_regs(Anx3429 *me,
 	return i2c_write_regs(&me->bus->ops, ANX_FW_I2C_ADDR, cmds, count);
 }
 
-static int __must_check write_block(Anx3429 *me, uint8_t reg,
-				    const uint8_t *data, size_t len)
+/*
+ * queue a block write to go out with the next register read,
+ * instead of in an EC passthru command of its own.
+ */
+
+static int __must_check queue_write_block(Anx3429 *me, uint8_t reg,
+					  const uint8_t *data, size_t len)
+{
+	uint8_t buf[len + 1];
+	I2cSeg seg = {
+		.read = 0, .chip = ANX_FW_I2C_ADDR, .buf = buf, .len = len + 1,
+	};
+
+	buf[0] = reg;
+	memcpy(buf + 1, data, len);
+	return cros_ec_tunnel_i2c_batch(me->bus, &seg, 1);
+}
+
+static int __must_check queue_write_reg(Anx3429 *me, uint8_t reg,
+					uint8_t data)
 {
-	return i2c_writeblock(&me->bus->ops, ANX_FW_I2C_ADDR, reg, data, len);
+	return queue_write_block(me, reg, &data, 1);
 }
 
 /*
@@ -181,13 +199,14 @@ static int __must_check write_block(Anx3429 *me, uint8_t reg,
  *	lower numbered reg gets the MSB
  */
 
-static int __must_check write_reg16(Anx3429 *me, uint8_t reg, uint16_t val)
+static int __must_check queue_write_reg16(Anx3429 *me, uint8_t reg,
+					  uint16_t val)
 {
 	uint8_t buf[2];
 
 	buf[0] = val >> 8;
 	buf[1] = val;
-	return write_block(me, reg, buf, sizeof(buf));
+	return queue_write_block(me, reg, buf, sizeof(buf));
 }
 
 static const uint8_t inactive_word[OTP_WORD_SIZE] = {
@@ -248,9 +267,11 @@ static int __must_check anx3429_otp_read72(
 {
 	uint64_t t0_us;
 
-	if (write_reg16(me, R_OTP_ADDR_HIGH, offset) != 0)
+	/* these go out with the first status read */
+	if (queue_write_reg16(me, R_OTP_ADDR_HIGH, offset) != 0)
 		return -1;
-	if (write_reg(me, R_OTP_CTL_1, flags|R_OTP_CTL_1_OTP_READ) != 0)
+	if (queue_write_reg(me, R_OTP_CTL_1,
+			    flags|R_OTP_CTL_1_OTP_READ) != 0)
 		return -1;
 
 	t0_us = timer_us(0);
@@ -349,15 +370,16 @@ static int __must_check anx3429_otp_write72raw(Anx3429 *me,
 {
 	uint64_t t0_us;
 
-	if (write_reg16(me, R_OTP_ADDR_HIGH, offset) != 0)
+	/* these go out with the first status read */
+	if (queue_write_reg16(me, R_OTP_ADDR_HIGH, offset) != 0)
 		return -1;
 
-	if (write_block(me, R_OTP_DATA_IN_0, word72, 8) != 0)
+	if (queue_write_block(me, R_OTP_DATA_IN_0, word72, 8) != 0)
 		return -1;
-	if (write_reg(me, R_OTP_ECC_IN, word72[8]) != 0)
+	if (queue_write_reg(me, R_OTP_ECC_IN, word72[8]) != 0)
 		return -1;
 
-	if (write_reg(me, R_OTP_CTL_1, R_OTP_CTL_1_WRITE_OTP72RAW) != 0)
+	if (queue_write_reg(me, R_OTP_CTL_1, R_OTP_CTL_1_WRITE_OTP72RAW) != 0)
 		return -1;
 
 	t0_us = timer_us(0);
@@ -94,6 +94,22 @@ static int __must_check write_reg(Anx3447 *me, uint8_t reg, uint8_t data)
 	return i2c_writeb(&me->bus->ops, ANX_FW_I2C_ADDR, reg, data);
 }
 
+/*
+ * Queue a register write to go out with the next register read, instead of
+ * in an EC passthru command of its own.
+ */
+static int __must_check queue_write_reg(Anx3447 *me, uint8_t reg,
+					uint8_t data)
+{
+	uint8_t buf[] = { reg, data };
+	I2cSeg seg = {
+		.read = 0, .chip = ANX_FW_I2C_ADDR,
+		.buf = buf, .len = ARRAY_SIZE(buf),
+	};
+
+	return cros_ec_tunnel_i2c_batch(me->bus, &seg, 1);
+}
+
 static int __must_check write_reg_or(Anx3447 *me, uint8_t reg, uint8_t data)
 {
 	uint8_t val;
@@ -234,12 +250,12 @@ static int __must_check anx3447_flash_write_block(Anx3447 *me, uint32_t addr,
 
 	/* move data to registers */
 	for (i = 0; i < DATA_BLOCK_SIZE; i++) {
-		if (write_reg(me, FLASH_WRITE_DATA_0 + i, buf[i]))
+		if (queue_write_reg(me, FLASH_WRITE_DATA_0 + i, buf[i]))
 			return -1;
 	}
 
 	/* flash write enable */
-	if (write_reg(me, FLASH_INSTRUCTION_TYPE, WRITE_EN))
+	if (queue_write_reg(me, FLASH_INSTRUCTION_TYPE, WRITE_EN))
 		return -1;
 
 	if (update_reg(me, R_FLASH_RW_CTRL, GENERAL_INSTRUCTION_EN,
@@ -256,17 +272,17 @@ static int __must_check anx3447_flash_write_block(Anx3447 *me, uint32_t addr,
 	if (update_reg(me, R_RAM_LEN_H, FLASH_ADDR_EXTEND, 0))
 		return -1;
 
-	if (write_reg(me, R_FLASH_ADDR_H, (uint8_t)(addr >> 8)))
+	if (queue_write_reg(me, R_FLASH_ADDR_H, (uint8_t)(addr >> 8)))
 		return -1;
 
-	if (write_reg(me, R_FLASH_ADDR_L, (uint8_t)(addr & 0xff)))
+	if (queue_write_reg(me, R_FLASH_ADDR_L, (uint8_t)(addr & 0xff)))
 		return -1;
 
 	/* write data length */
-	if (write_reg(me, R_FLASH_LEN_H, 0x0))
+	if (queue_write_reg(me, R_FLASH_LEN_H, 0x0))
 		return -1;
 
-	if (write_reg(me, R_FLASH_LEN_L, 0x1f))
+	if (queue_write_reg(me, R_FLASH_LEN_L, 0x1f))
 		return -1;
 
 	/* flash write start */
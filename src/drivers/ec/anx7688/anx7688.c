@@ -95,8 +95,24 @@ int anx7688_detect(struct Anx7688 *me)
 	return (vendor == VENDOR && product == PRODUCT);
 }
 
+/*
+ * Queue a block write to go out with the next status read, instead of in
+ * an EC passthru command of its own.
+ */
+static int queue_writeblock(CrosECTunnelI2c *bus, uint8_t reg,
+			    const uint8_t *data, int len)
+{
+	uint8_t buf[len + 1];
+	I2cSeg seg = { .read = 0, .chip = CHIP_FW, .buf = buf, .len = len + 1 };
+
+	buf[0] = reg;
+	memcpy(buf + 1, data, len);
+	return cros_ec_tunnel_i2c_batch(bus, &seg, 1);
+}
+
 /* Returns -1 on error, 0 if the block does not match, 1 if it matches. */
-static int verify_block(I2cOps *bus, int address, const uint8_t *block)
+static int verify_block(CrosECTunnelI2c *bus, int address,
+			const uint8_t *block)
 {
 	uint8_t status;
 	uint8_t buffer[16];
@@ -107,7 +123,7 @@ static int verify_block(I2cOps *bus, int address, const uint8_t *block)
 	/* Write address and read command */
 	uint8_t cmdbuf[3] = {address >> 8, address & 0xFF, 0x06};
 
-	if (i2c_writeblock(bus, CHIP_FW, 0xE0, cmdbuf, sizeof(cmdbuf)) < 0)
+	if (queue_writeblock(bus, 0xE0, cmdbuf, sizeof(cmdbuf)) < 0)
 		return -1;
 
 	start_time = timer_us(0);
@@ -116,12 +132,12 @@ static int verify_block(I2cOps *bus, int address, const uint8_t *block)
 			printf("%s: Timeout\n", __func__);
 			return -1;
 		}
-		if (i2c_readb(bus, CHIP_FW, 0xE2, &status) < 0)
+		if (i2c_readb(&bus->ops, CHIP_FW, 0xE2, &status) < 0)
 			return -1;
 	} while ((status & 0x08) == 0);
 
 	/* Read data */
-	if (i2c_readblock(bus, CHIP_FW, 0xD0, buffer, 16) < 0)
+	if (i2c_readblock(&bus->ops, CHIP_FW, 0xD0, buffer, 16) < 0)
 		return -1;
 
 	if (memcmp(buffer, block, 16) != 0)
@@ -130,7 +146,8 @@ static int verify_block(I2cOps *bus, int address, const uint8_t *block)
 	return 1;
 }
 
-static int write_block(I2cOps *bus, int address, const uint8_t *block)
+static int write_block(CrosECTunnelI2c *bus, int address,
+		       const uint8_t *block)
 {
 	uint8_t status;
 	uint64_t start_time;
@@ -145,7 +162,7 @@ static int write_block(I2cOps *bus, int address, const uint8_t *block)
 	cmdbuf[17] = address & 0xFF;
 	cmdbuf[18] = 0x01;
 
-	if (i2c_writeblock(bus, CHIP_FW, 0xD0, cmdbuf, sizeof(cmdbuf)) < 0)
+	if (queue_writeblock(bus, 0xD0, cmdbuf, sizeof(cmdbuf)) < 0)
 		return -1;
 
 	start_time = timer_us(0);
@@ -154,7 +171,7 @@ static int write_block(I2cOps *bus, int address, const uint8_t *block)
 			printf("%s: Timeout\n", __func__);
 			return -1;
 		}
-		if (i2c_readb(bus, CHIP_FW, 0xE2, &status) < 0)
+		if (i2c_readb(&bus->ops, CHIP_FW, 0xE2, &status) < 0)
 			return -1;
 	} while ((status & 0x08) == 0x00);
 
@@ -165,7 +182,8 @@ static int write_block(I2cOps *bus, int address, const uint8_t *block)
 }
 
 /* Verify, compare, then (possibly) write and verify again a 16-byte block. */
-static int update_block(I2cOps *bus, int address, const uint8_t *block)
+static int update_block(CrosECTunnelI2c *bus, int address,
+			const uint8_t *block)
 {
 	int ret;
 
@@ -307,7 +325,7 @@ static vb2_error_t anx7688_update(struct Anx7688 *me,
 		/* Align to 16 byte boundary */
 		address = ALIGN_DOWN(le16toh(crc32data[i]), 16);
 		assert(address+16 <= rawlen);
-		ret = update_block(&me->bus->ops, address, &rawdata[address]);
+		ret = update_block(me->bus, address, &rawdata[address]);
 
 		if (ret < 0)
 			goto out;
@@ -321,8 +339,8 @@ static vb2_error_t anx7688_update(struct Anx7688 *me,
 		 * update. */
 		for (address = end-16; address >= start; address -= 16) {
 			assert(address+16 <= rawlen);
-			ret = update_block(&me->bus->ops,
-					   address, &rawdata[address]);
+			ret = update_block(me->bus, address,
+					   &rawdata[address]);
 
 			if (ret < 0)
 				goto out;
@@ -37,11 +37,52 @@
 
 #define DEFAULT_BUF_SIZE 0x100
 
+/* How long a snapshot of the EC memmap is used before reading it again. */
+#define MEMMAP_SNAPSHOT_US (20 * USECS_PER_MSEC)
+
 /* List of registered chip drivers to perform auxfw update */
 struct list_node ec_aux_fw_chip_list;
 
 static int ec_init(CrosEc *me);
 
+/* Host commands sent this boot, and the most sent in any one second. */
+static uint32_t host_command_count;
+static uint32_t host_command_peak;
+static uint32_t host_command_second_count;
+static uint64_t host_command_second_start;
+
+static uint8_t memmap_snapshot[EC_MEMMAP_SIZE];
+static uint64_t memmap_snapshot_time;
+static int memmap_snapshot_valid;
+/* Set if the memmap doesn't fit in one response, so it's read piecemeal. */
+static int memmap_snapshot_unsupported;
+
+static int ec_print_stats(CleanupFunc *cleanup, CleanupType type)
+{
+	printf("EC: %u host commands, at most %u in one second.\n",
+	       host_command_count, host_command_peak);
+	return 0;
+}
+
+static CleanupFunc ec_stats_cleanup = {
+	.cleanup = &ec_print_stats,
+	.types = CleanupOnHandoff | CleanupOnLegacy,
+};
+static int ec_stats_installed;
+
+static void count_host_command(void)
+{
+	if (!host_command_count || timer_us(host_command_second_start) >=
+				   USECS_PER_SEC) {
+		host_command_second_start = timer_us(0);
+		host_command_second_count = 0;
+	}
+
+	host_command_count++;
+	host_command_second_count++;
+	host_command_peak = MAX(host_command_peak, host_command_second_count);
+}
+
 void cros_ec_dump_data(const char *name, int cmd, const void *data, int len)
 {
 #ifdef DEBUG
@@ -284,6 +325,7 @@ int ec_command(CrosEc *me, int cmd, int cmd_version,
 	if (!me->initialized && ec_init(me))
 		return -1;
 
+	count_host_command();
 	return send_command_proto3(me, cmd, cmd_version, dout, dout_len, din,
 				   din_len);
 }
@@ -577,7 +619,7 @@ int cros_ec_set_motion_sense_activity(uint32_t activity, uint32_t value)
 	return 0;
 }
 
-static int read_memmap(uint8_t offset, uint8_t size, void *dest)
+static int read_memmap_uncached(uint8_t offset, uint8_t size, void *dest)
 {
 	struct ec_params_read_memmap params;
 
@@ -595,6 +637,49 @@ static int read_memmap(uint8_t offset, uint8_t size, void *dest)
 	return 0;
 }
 
+/*
+ * Refresh the copy of the whole EC memmap region, read in one host command,
+ * if it is too old to use.
+ */
+static int update_memmap_snapshot(CrosEc *ec)
+{
+	if (memmap_snapshot_valid &&
+	    timer_us(memmap_snapshot_time) < MEMMAP_SNAPSHOT_US)
+		return 0;
+
+	memmap_snapshot_valid = 0;
+	if (memmap_snapshot_unsupported)
+		return -1;
+
+	if (!ec->initialized && ec_init(ec))
+		return -1;
+	if (ec->proto3_response_size - sizeof(struct ec_host_response) <
+	    sizeof(memmap_snapshot)) {
+		memmap_snapshot_unsupported = 1;
+		return -1;
+	}
+
+	if (read_memmap_uncached(0, sizeof(memmap_snapshot), memmap_snapshot))
+		return -1;
+
+	memmap_snapshot_time = timer_us(0);
+	memmap_snapshot_valid = 1;
+	return 0;
+}
+
+static int read_memmap(uint8_t offset, uint8_t size, void *dest)
+{
+	CrosEc *ec = cros_ec_get();
+
+	/* LPC reads go straight to the EC's memory, which is cheaper. */
+	if (ec->bus->read || offset + size > sizeof(memmap_snapshot) ||
+	    update_memmap_snapshot(ec))
+		return read_memmap_uncached(offset, size, dest);
+
+	memcpy(dest, memmap_snapshot + offset, size);
+	return 0;
+}
+
 int cros_ec_read_batt_volt(uint32_t *volt)
 {
 	return read_memmap(EC_MEMMAP_BATT_VOLT, sizeof(*volt), volt);
@@ -730,13 +815,25 @@ int cros_ec_read_batt_state_of_charge(uint32_t *state)
 {
 	struct ec_params_charge_state params;
 	struct ec_response_charge_state resp;
+	static uint32_t last_state;
+	static uint64_t last_time;
+	static int last_valid;
+
+	/* This isn't in the memmap, so keep the answer for as long instead. */
+	if (last_valid && timer_us(last_time) < MEMMAP_SNAPSHOT_US) {
+		*state = last_state;
+		return 0;
+	}
 
 	params.cmd = CHARGE_STATE_CMD_GET_STATE;
 
 	if (ec_cmd_charge_state(cros_ec_get(), &params, &resp) < 0)
 		return -1;
 
-	*state = resp.get_state.batt_state_of_charge;
+	last_state = resp.get_state.batt_state_of_charge;
+	last_time = timer_us(0);
+	last_valid = 1;
+	*state = last_state;
 	return 0;
 }
 
@@ -900,6 +997,12 @@ static int ec_init(CrosEc *me)
 	set_max_proto3_sizes(me, info.max_request_packet_size,
 			     info.max_response_packet_size);
 
+	if (!ec_stats_installed) {
+		list_insert_after(&ec_stats_cleanup.list_node,
+				  &cleanup_funcs);
+		ec_stats_installed = 1;
+	}
+
 	return 0;
 }
 
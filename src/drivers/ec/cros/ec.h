@@ -72,6 +72,11 @@ typedef struct CrosEc
 	int proto3_request_size;
 	struct ec_host_response *proto3_response;
 	int proto3_response_size;
+	/* EC_CMD_FLASH_WRITE burst size and version, once looked up. */
+	uint32_t flash_write_burst;
+	int flash_write_version;
+	/* Parameter buffer reused for every EC_CMD_FLASH_WRITE burst. */
+	uint8_t *flash_write_buf;
 } CrosEc;
 
 /* Maximum wait time for EC flash erase completion */
@@ -2,9 +2,11 @@
 
 #include <assert.h>
 #include <libpayload.h>
+#include <lp_vboot.h>
 #include <vb2_api.h>
 
 #include "base/cleanup_funcs.h"
+#include "base/timestamp.h"
 #include "drivers/bus/i2c/cros_ec_tunnel.h"
 #include "drivers/ec/cros/commands.h"
 #include "drivers/ec/cros/commands_api.h"
@@ -17,6 +19,9 @@ static const int CROS_EC_HASH_TIMEOUT_MS = 2000;
 /* Time to delay between polling status of EC hash calculation */
 static const int CROS_EC_HASH_CHECK_DELAY_MS = 10;
 
+/* Time to delay between polling status of an asynchronous flash erase */
+static const int CROS_EC_ERASE_CHECK_DELAY_MS = 10;
+
 static vb2_error_t vboot_running_rw(VbootEcOps *vbec, int *in_rw)
 {
 	CrosEc *me = container_of(vbec, CrosEc, vboot);
@@ -78,6 +83,7 @@ static vb2_error_t vboot_hash_image(VbootEcOps *vbec,
 
 	hash_offset = get_vboot_hash_offset(select);
 
+	timestamp_add_now(TS_VB_EC_HASH_WAIT_START);
 	start = timer_us(0);
 	do {
 		/* Get hash if available. */
@@ -119,6 +125,7 @@ static vb2_error_t vboot_hash_image(VbootEcOps *vbec,
 		}
 	} while (resp.status == EC_VBOOT_HASH_STATUS_BUSY &&
 		 timer_us(start) < CROS_EC_HASH_TIMEOUT_MS * 1000);
+	timestamp_add_now(TS_VB_EC_HASH_WAIT_END);
 
 	if (resp.status != EC_VBOOT_HASH_STATUS_DONE) {
 		printf("%s: Hash status not done: %d\n", __func__,
@@ -136,6 +143,39 @@ static vb2_error_t vboot_hash_image(VbootEcOps *vbec,
 	return VB2_SUCCESS;
 }
 
+/*
+ * Ask the EC to start hashing its active RW image as soon as the board
+ * registers it, so that the hash is ready by the time EC software sync asks
+ * vboot_hash_image() for it.
+ */
+static void vboot_start_hash(VbootEcOps *vbec)
+{
+	CrosEc *me = container_of(vbec, CrosEc, vboot);
+	struct ec_params_vboot_hash p = { 0 };
+	struct ec_response_vboot_hash resp;
+
+	if (!CONFIG(EC_VBOOT_SUPPORT))
+		return;
+
+	if (vb2api_gbb_get_flags(vboot_get_context()) &
+	    VB2_GBB_FLAG_DISABLE_EC_SOFTWARE_SYNC)
+		return;
+
+	/* Leave the EC alone if it has a hash or is already computing one. */
+	p.cmd = EC_VBOOT_HASH_GET;
+	p.offset = EC_VBOOT_HASH_OFFSET_ACTIVE;
+	if (ec_cmd_vboot_hash(me, &p, &resp) < 0 ||
+	    resp.status != EC_VBOOT_HASH_STATUS_NONE)
+		return;
+
+	/* This is only to save time later, so errors don't matter. */
+	p.cmd = EC_VBOOT_HASH_START;
+	p.hash_type = EC_VBOOT_HASH_TYPE_SHA256;
+	p.nonce_size = 0;
+	if (ec_cmd_vboot_hash(me, &p, &resp) >= 0)
+		printf("EC: Started hashing the active RW image\n");
+}
+
 static vb2_error_t vboot_reboot_to_ro(VbootEcOps *vbec)
 {
 	CrosEc *me = container_of(vbec, CrosEc, vboot);
@@ -245,10 +285,38 @@ static int ec_flash_offset(CrosEc *me, enum ec_flash_region region,
 static int ec_flash_erase(CrosEc *me, uint32_t offset, uint32_t size)
 {
 	struct ec_params_flash_erase p;
+	struct ec_params_flash_erase_v1 p1;
+	uint64_t start;
+	int rv;
 
 	p.offset = offset;
 	p.size = size;
-	return ec_cmd_flash_erase(me, &p);
+	if (!cros_ec_cmd_version_supported(EC_CMD_FLASH_ERASE, 1))
+		return ec_cmd_flash_erase(me, &p);
+
+	/*
+	 * Start the erase in the background and poll for the result, rather
+	 * than waiting on IN_PROGRESS, which is only checked every 50ms.
+	 */
+	memset(&p1, 0, sizeof(p1));
+	p1.cmd = FLASH_ERASE_SECTOR_ASYNC;
+	p1.params = p;
+	rv = ec_command(me, EC_CMD_FLASH_ERASE, 1, &p1, sizeof(p1), NULL, 0);
+	if (rv < 0)
+		return rv;
+
+	p1.cmd = FLASH_ERASE_GET_RESULT;
+	start = timer_us(0);
+	do {
+		mdelay(CROS_EC_ERASE_CHECK_DELAY_MS);
+		rv = ec_command(me, EC_CMD_FLASH_ERASE, 1, &p1, sizeof(p1),
+				NULL, 0);
+		if (rv != -EC_RES_BUSY)
+			return rv < 0 ? rv : 0;
+	} while (timer_us(start) < CROS_EC_ERASE_TIMEOUT_MS * 1000);
+
+	printf("%s: Timed out erasing EC flash\n", __func__);
+	return -EC_RES_TIMEOUT;
 }
 
 /**
@@ -271,10 +339,8 @@ static int ec_flash_erase(CrosEc *me, uint32_t offset, uint32_t size)
 static int ec_flash_write_block(CrosEc *me, const uint8_t *data,
 				uint32_t offset, uint32_t size)
 {
-	uint8_t *buf;
 	struct ec_params_flash_write *p;
 	uint32_t bufsize = sizeof(*p) + size;
-	int rv;
 
 	assert(data);
 
@@ -282,23 +348,21 @@ static int ec_flash_write_block(CrosEc *me, const uint8_t *data,
 	if (bufsize > me->max_param_size)
 		return -1;
 
-	buf = xmalloc(bufsize);
+	/* Every burst fits in max_param_size, so one buffer does for all. */
+	if (!me->flash_write_buf)
+		me->flash_write_buf = xmalloc(me->max_param_size);
 
-	p = (struct ec_params_flash_write *)buf;
+	p = (struct ec_params_flash_write *)me->flash_write_buf;
 	p->offset = offset;
 	p->size = size;
 	memcpy(p + 1, data, size);
 
-	rv = ec_command(me, EC_CMD_FLASH_WRITE,
-			0, buf, bufsize, NULL, 0) >= 0 ? 0 : -1;
-
-	free(buf);
-
-	return rv;
+	return ec_command(me, EC_CMD_FLASH_WRITE, me->flash_write_version,
+			  p, bufsize, NULL, 0) >= 0 ? 0 : -1;
 }
 
 /**
- * Return optimal flash write burst size
+ * Return optimal flash write burst size, and pick the command version
  */
 static int ec_flash_write_burst_size(CrosEc *me)
 {
@@ -306,23 +370,33 @@ static int ec_flash_write_burst_size(CrosEc *me)
 	uint32_t pdata_max_size = me->max_param_size -
 		sizeof(struct ec_params_flash_write);
 
+	/* This doesn't change, so only ask the EC the first time. */
+	if (me->flash_write_burst)
+		return me->flash_write_burst;
+
 	/*
 	 * Determine whether we can use version 1 of the command with more
 	 * data, or only version 0.
 	 */
 	if (!cros_ec_cmd_version_supported(EC_CMD_FLASH_WRITE,
-					   EC_VER_FLASH_WRITE))
-		return EC_FLASH_WRITE_VER0_SIZE;
+					   EC_VER_FLASH_WRITE)) {
+		me->flash_write_version = 0;
+		me->flash_write_burst = EC_FLASH_WRITE_VER0_SIZE;
+		return me->flash_write_burst;
+	}
 
 	/*
 	 * Determine step size.  This must be a multiple of the write block
 	 * size, and must also fit into the host parameter buffer.
 	 */
-	if (ec_cmd_flash_info(me, &info) != sizeof(info))
+	if (ec_cmd_flash_info(me, &info) != sizeof(info) ||
+	    !info.write_block_size)
 		return 0;
 
-	return (pdata_max_size / info.write_block_size) *
+	me->flash_write_version = EC_VER_FLASH_WRITE;
+	me->flash_write_burst = (pdata_max_size / info.write_block_size) *
 		info.write_block_size;
+	return me->flash_write_burst;
 }
 
 /**
@@ -436,6 +510,7 @@ static vb2_error_t vboot_update_image(VbootEcOps *vbec,
 	CrosEc *me = container_of(vbec, CrosEc, vboot);
 	uint32_t region_offset, region_size;
 	enum ec_flash_region region = vboot_to_ec_region(select);
+	uint64_t start;
 	vb2_error_t rv = vboot_set_region_protection(me, 0);
 	if (rv == VB2_REQUEST_REBOOT_EC_TO_RO || rv != VB2_SUCCESS)
 		return rv;
@@ -457,8 +532,11 @@ static vb2_error_t vboot_update_image(VbootEcOps *vbec,
 		return VB2_ERROR_UNKNOWN;
 
 	/* Write the image */
+	start = timer_us(0);
 	if (ec_flash_write(me, image, region_offset, image_size))
 		return VB2_ERROR_UNKNOWN;
+	printf("Wrote %d bytes of EC image in %llu us.\n", image_size,
+	       timer_us(start));
 
 	/* Verify the image */
 	if (CONFIG(EC_EFS) && ec_efs_verify(me, region))
@@ -535,6 +613,7 @@ CrosEc *new_cros_ec(CrosEcBusOps *bus, GpioOps *interrupt_gpio)
 	me->vboot.check_limit_power = vboot_check_limit_power;
 	me->vboot.enable_power_button = vboot_enable_power_button;
 	me->vboot.protect_tcpc_ports = vboot_protect_tcpc_ports;
+	me->vboot.start_hash = vboot_start_hash;
 
 	return me;
 }
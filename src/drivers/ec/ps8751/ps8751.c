@@ -220,10 +220,26 @@ int __must_check ps8751_write_reg(Ps8751 *me,
 	return i2c_writeb(&me->bus->ops, page, reg, data);
 }
 
+int __must_check ps8751_queue_write_reg(Ps8751 *me, uint8_t page,
+					uint8_t reg, uint8_t data)
+{
+	uint8_t buf[] = { reg, data };
+	I2cSeg seg = {
+		.read = 0, .chip = page, .buf = buf, .len = ARRAY_SIZE(buf),
+	};
+
+	return cros_ec_tunnel_i2c_batch(me->bus, &seg, 1);
+}
+
 int __must_check ps8751_write_regs(Ps8751 *me, uint8_t page,
 				   const I2cWriteVec *cmds, const size_t count)
 {
-	return i2c_write_regs(&me->bus->ops, page, cmds, count);
+	for (size_t i = 0; i < count; ++i) {
+		if (ps8751_queue_write_reg(me, page, cmds[i].reg,
+					   cmds[i].val) != 0)
+			return -1;
+	}
+	return cros_ec_tunnel_i2c_flush(me->bus) ? -1 : 0;
 }
 
 int __must_check ps8751_read_reg(Ps8751 *me,
@@ -236,7 +252,18 @@ int __must_check ps8751_read_regs(Ps8751 *me,
 				  uint8_t chip, const uint8_t *regs,
 				  const size_t count, uint8_t *data)
 {
-	return i2c_read_regs(&me->bus->ops, chip, regs, count, data);
+	for (size_t i = 0; i < count; ++i) {
+		I2cSeg seg[] = {
+			{ .read = 0, .chip = chip,
+			  .buf = (uint8_t *)&regs[i], .len = 1 },
+			{ .read = 1, .chip = chip, .buf = &data[i], .len = 1 },
+		};
+
+		if (cros_ec_tunnel_i2c_batch(me->bus, seg,
+					     ARRAY_SIZE(seg)) != 0)
+			return -1;
+	}
+	return cros_ec_tunnel_i2c_flush(me->bus) ? -1 : 0;
 }
 
 int __must_check ps8751_spi_fifo_wait_busy(Ps8751 *me)
@@ -1044,7 +1071,8 @@ int __must_check ps8751_spi_setup_cmd24(Ps8751 *me, uint8_t cmd, uint32_t a24)
 
 /**
  * issue a single flash sector erase command to
- * erase PARADE_FW_SECTOR (4KB) bytes.
+ * erase PARADE_FW_SECTOR (4KB) bytes. this doesn't wait
+ * for the erase to finish, see ps8751_sector_erase_done().
  *
  * @param me		device context
  * @param offset	device byte offset, but containing
@@ -1052,7 +1080,8 @@ int __must_check ps8751_spi_setup_cmd24(Ps8751 *me, uint8_t cmd, uint32_t a24)
  * @return 0 if ok, -1 on error
  */
 
-static int __must_check ps8751_sector_erase(Ps8751 *me, uint32_t offset)
+static int __must_check ps8751_sector_erase_start(Ps8751 *me,
+						  uint32_t offset)
 {
 	if (ps8751_spi_cmd_enable_writes(me) != 0)
 		return -1;
@@ -1067,42 +1096,67 @@ static int __must_check ps8751_sector_erase(Ps8751 *me, uint32_t offset)
 		return -1;
 	if (ps8751_spi_fifo_wait_busy(me) != 0)
 		return -1;
-	if (ps8751_spi_wait_rom_ready(me) != 0)
-		return -1;
 	return 0;
 }
 
 /**
- * erase a chunk of flash.  offset and data_size must be sector aligned,
- * which is PARADE_FW_SECTOR (4KB).
- *
- * assumes SPI interface has been enabled for programming.
+ * check once whether a sector erase has finished, the
+ * non-blocking version of ps8751_spi_wait_rom_ready()
  *
  * @param me		device context
- * @param offset	device offset, 1st byte to erase
- * @param data_size	number of bytes to erase
- * @return 0 if ok, -1 on error
+ * @return 1 if finished, 0 if still in progress, -1 on error
  */
 
-static int __must_check ps8751_erase(Ps8751 *me,
-				     uint32_t offset, uint32_t data_size)
+static int __must_check ps8751_sector_erase_done(Ps8751 *me)
 {
-	uint32_t end = offset + data_size;
-	int rval = 0;
-	uint64_t t0_us;
+	uint8_t busy;
+	uint8_t status;
+
+	if (ps8751_read_reg(me, me->addr_page_2, P2_SPI_STATUS, &busy) != 0)
+		return -1;
+	if ((busy & 0x3f) != 0x00)
+		return 0;
+	if (ps8751_spi_cmd_read_status(me, &status) != 0)
+		return -1;
+	return (status & SPI_STATUS_WIP) == 0;
+}
 
-	debug("offset 0x%06x size %u\n", offset, data_size);
+/**
+ * program the next piece of flash, skipping leading 0xff bytes
+ *
+ * @param me		device context
+ * @param a24		flash device offset to program
+ * @param data		addr of data to write
+ * @param data_size	size of data left to write
+ * @param skipped	incremented by the number of bytes skipped
+ * @return number of bytes done, -1 on error
+ */
 
-	t0_us = timer_us(0);
-	for (; offset < end; offset += PARADE_FW_SECTOR) {
-		if (ps8751_sector_erase(me, offset) != VB2_SUCCESS)
-			rval = -1;
+static int __must_check ps8751_program_chunk(Ps8751 *me,
+					     const uint32_t a24,
+					     const uint8_t * const data,
+					     const int data_size,
+					     int *skipped)
+{
+	int skips;
+	int chunk;
+
+	/* skip leading 0xff bytes and potentially the entire chunk */
+	for (skips = 0; skips < data_size; ++skips) {
+		if (data[skips] != 0xff)
+			break;
 	}
-	printf("%s: erased %uKB in %ums\n",
-	       me->chip_name,
-	       data_size >> 10,
-	       (unsigned)USEC_TO_MSEC(timer_us(t0_us)));
-	return rval;
+	*skipped += skips;
+
+	if (skips == data_size)
+		return data_size;
+
+	chunk = me->flash_write(me, data + skips, data_size - skips,
+				a24 + skips);
+	if (chunk < 0)
+		return -1;
+
+	return skips + chunk;
 }
 
 /**
@@ -1140,26 +1194,10 @@ static int __must_check ps8751_program(Ps8751 *me,
 	for (data_offset = 0;
 	     data_offset < data_size;
 	     data_offset += chunk) {
-		int skips;
-
-		chunk = data_size - data_offset;
-
-		/* skip leading 0xff bytes and potentially the entire chunk */
-		for (skips = 0; skips < chunk; ++skips) {
-			if (data[data_offset + skips] != 0xff)
-				break;
-		}
-		bytes_skipped += skips;
-
-		if (skips == chunk)
-			continue;
-
-		data_offset += skips;
-		chunk -= skips;
-
-		chunk = me->flash_write(me,
-					data + data_offset, chunk,
-					fw_start + data_offset);
+		chunk = ps8751_program_chunk(me, fw_start + data_offset,
+					     data + data_offset,
+					     data_size - data_offset,
+					     &bytes_skipped);
 		if (chunk < 0) {
 			status = -1;
 			break;
@@ -1415,11 +1453,7 @@ static void ps8751_dump_flash(Ps8751 *me,
 }
 
 /**
- * install a new firmware image, replacing whatever was there before,
- * then verify installed data.
- *
- * the MPU is assumed to be stopped (highly recommended)
- * the SPI bus and flash are write-enabled
+ * check a new firmware image before anything is erased
  *
  * @param me		device context
  * @param data		addr of firmware blob to install
@@ -1427,10 +1461,9 @@ static void ps8751_dump_flash(Ps8751 *me,
  * @return 0 if ok, -1 on error
  */
 
-static int ps8751_reflash(Ps8751 *me, const uint8_t *data, size_t data_size)
+static int ps8751_reflash_check(Ps8751 *me,
+				const uint8_t *data, size_t data_size)
 {
-	int status;
-
 	printf("%s: updating %s FW\n", me->chip_name,
 	       me->fw_type == PARADE_FW_BASE? "base" : "application");
 
@@ -1461,25 +1494,53 @@ static int ps8751_reflash(Ps8751 *me, const uint8_t *data, size_t data_size)
 		}
 	}
 
-	status = ps8751_erase(me, PARADE_BOOT_HEADER_START, PARADE_FW_SECTOR);
-	if (status != 0) {
-		printf("%s: boot header erase failed\n", me->chip_name);
-		return -1;
+	return 0;
+}
+
+/**
+ * start erasing the next sector, first the boot header and then the
+ * firmware, and move on to programming once everything is erased.
+ *
+ * @param me		device context
+ * @param data_size	size of firmware blob to install
+ * @return 0 if ok, -1 on error
+ */
+
+static int __must_check ps8751_update_erase(Ps8751 *me, size_t data_size)
+{
+	if (me->update.offset < me->update.end) {
+		if (ps8751_sector_erase_start(me, me->update.offset) != 0) {
+			printf("%s: %s erase failed\n", me->chip_name,
+			       me->update.erase_fw ? "FW" : "boot header");
+			return -1;
+		}
+		me->update.wait_us = timer_us(0);
+		me->update.poll_us = me->update.wait_us;
+		me->update.state = PS_UPDATE_ERASE_WAIT;
+		return 0;
 	}
 
-	status = ps8751_erase(me, me->fw_start, data_size);
-	if (status != 0) {
-		printf("%s: FW erase failed\n", me->chip_name);
-		return -1;
+	printf("%s: erased %uKB in %ums\n",
+	       me->chip_name,
+	       (me->update.erase_fw ? (unsigned)data_size :
+		PARADE_FW_SECTOR) >> 10,
+	       (unsigned)USEC_TO_MSEC(timer_us(me->update.t0_us)));
+
+	if (!me->update.erase_fw) {
+		me->update.erase_fw = 1;
+		me->update.offset = me->fw_start;
+		me->update.end = me->fw_start + data_size;
+		me->update.t0_us = timer_us(0);
+		return 0;
 	}
+
 	/*
 	 * quick confidence check to see if we modified flash
 	 * we'll do a full verify after programming
 	 */
-	status = ps8751_verify(me, me->fw_start,
-			       erased_bytes,
-			       MIN(data_size, sizeof(erased_bytes)));
-	if (status != 0) {
+	if (ps8751_verify(me, me->fw_start,
+			  erased_bytes,
+			  MIN(data_size, sizeof(erased_bytes))) != 0) {
 		printf("%s: FW erase verify failed\n", me->chip_name);
 		return -1;
 	}
@@ -1488,19 +1549,116 @@ static int ps8751_reflash(Ps8751 *me, const uint8_t *data, size_t data_size)
 		debug("start post erase 7s delay...\n");
 		mdelay(7 * 1000);
 		debug("end post erase delay\n");
-	}
-
-	if (PS8751_DEBUG >= 2)
 		ps8751_dump_flash(me, me->fw_start,
 				  me->fw_end - me->fw_start);
-	status = ps8751_program(me, me->fw_start, data, data_size);
-	if (PS8751_DEBUG >= 2)
-		ps8751_dump_flash(me, me->fw_start, PARADE_TEST_FW_SIZE);
-	if (status != 0) {
-		printf("%s: FW program failed\n", me->chip_name);
+	}
+
+	printf("%s: programming %uKB...\n", me->chip_name,
+	       (unsigned)data_size >> 10);
+
+	me->flash_start(me);
+	if (me->flash_write_enable(me) < 0)
 		return -1;
+
+	me->update.offset = 0;
+	me->update.bytes_skipped = 0;
+	me->update.t0_us = timer_us(0);
+	me->update.state = PS_UPDATE_PROGRAM;
+	return 0;
+}
+
+/**
+ * see whether the sector erase has finished, without waiting for it
+ *
+ * @param me		device context
+ * @return 0 if ok, -1 on error
+ */
+
+static int __must_check ps8751_update_erase_wait(Ps8751 *me)
+{
+	int done;
+
+	/* don't bother the chip more often than needed */
+	if (timer_us(me->update.poll_us) < PS_ERASE_POLL_US)
+		return 0;
+
+	done = ps8751_sector_erase_done(me);
+	if (done < 0)
+		return -1;
+	if (!done) {
+		if (timer_us(me->update.wait_us) >= PS_WIP_TIMEOUT_US) {
+			printf("%s: flash erase timeout after %ums\n",
+			       me->chip_name, USEC_TO_MSEC(PS_WIP_TIMEOUT_US));
+			return -1;
+		}
+		me->update.poll_us = timer_us(0);
+		return 0;
+	}
+
+	me->update.offset += PARADE_FW_SECTOR;
+	me->update.state = PS_UPDATE_ERASE;
+	return 0;
+}
+
+/**
+ * program the next chunk of the new firmware
+ *
+ * @param me		device context
+ * @param data		addr of firmware blob to install
+ * @param data_size	size of firmware blob to install
+ * @return 0 if ok, -1 on error
+ */
+
+static int __must_check ps8751_update_program(Ps8751 *me,
+					      const uint8_t *data,
+					      size_t data_size)
+{
+	const uint32_t offset = me->update.offset;
+	int chunk;
+
+	if (offset < data_size) {
+		chunk = ps8751_program_chunk(me, me->fw_start + offset,
+					     data + offset, data_size - offset,
+					     &me->update.bytes_skipped);
+		if (chunk < 0) {
+			printf("%s: FW program failed\n", me->chip_name);
+			me->flash_write_disable(me);
+			return -1;
+		}
+		me->update.offset += chunk;
+		return 0;
 	}
 
+	printf("%s: programmed %uKB in %ums (%uB skipped)\n",
+	       me->chip_name,
+	       (unsigned)data_size >> 10,
+	       (unsigned int)USEC_TO_MSEC(timer_us(me->update.t0_us)),
+	       me->update.bytes_skipped);
+
+	if (me->flash_write_disable(me) < 0)
+		return -1;
+
+	if (PS8751_DEBUG >= 2)
+		ps8751_dump_flash(me, me->fw_start, PARADE_TEST_FW_SIZE);
+
+	me->update.state = PS_UPDATE_VERIFY;
+	return 0;
+}
+
+/**
+ * verify the new firmware and, for an application image, point the
+ * bootloader at it.
+ *
+ * @param me		device context
+ * @param data		addr of firmware blob to install
+ * @param data_size	size of firmware blob to install
+ * @return 0 if ok, -1 on error
+ */
+
+static int __must_check ps8751_update_verify(Ps8751 *me,
+					     const uint8_t *data,
+					     size_t data_size)
+{
 	if (ps8751_verify(me, me->fw_start, data, data_size) != 0) {
 		if (PS8751_DEBUG > 0)
 			ps8751_dump_flash(me, me->fw_start, data_size);
@@ -1518,9 +1676,8 @@ static int ps8751_reflash(Ps8751 *me, const uint8_t *data, size_t data_size)
 		 * Program a boot header pointing to the app for the
 		 * bootloader to follow.
 		 */
-		status = ps8751_program(me, PARADE_BOOT_HEADER_START,
-					header, sizeof(header));
-		if (status != 0) {
+		if (ps8751_program(me, PARADE_BOOT_HEADER_START,
+				   header, sizeof(header)) != 0) {
 			printf("%s: boot header program failed\n",
 			       me->chip_name);
 			return -1;
@@ -1530,6 +1687,7 @@ static int ps8751_reflash(Ps8751 *me, const uint8_t *data, size_t data_size)
 			return -1;
 	}
 
+	me->update.state = PS_UPDATE_DONE;
 	return 0;
 }
 
@@ -1589,113 +1747,179 @@ static vb2_error_t ps8751_check_hash(const VbootAuxfwOps *vbaux,
 	return VB2_SUCCESS;
 }
 
-static int ps8751_halt_and_flash(Ps8751 *me,
-				 const uint8_t *image, size_t image_size)
-{
-	int status = -1;
-
-	if (ps8751_rom_ctrl(me) != 0)
-		return -1;
-
-	if (ps8751_disable_mpu(me) != 0)
-		return -1;
-
-	if (ps8751_reinit_spi(me) != 0)
-		goto enable_mpu;
-
-	if (ps8751_set_i2c_speed(me) != 0)
-		goto enable_mpu;
+/**
+ * undo the chip setup done for an update, resume the PD port and
+ * wait for the chip to come back.
+ *
+ * @param me		device context
+ * @param status	outcome of the update so far
+ * @return status, or an error if cleaning up failed
+ */
 
-	if (ps8751_spi_flash_unlock(me) != 0)
-		goto restore_i2c;
+static vb2_error_t ps8751_update_end(Ps8751 *me, vb2_error_t status)
+{
+	const Ps8751UpdateSetup setup = me->update.setup;
+	int timeout;
 
-	debug("unlock_spi_bus returned\n");
+	me->update.state = PS_UPDATE_IDLE;
+	me->update.setup = PS_SETUP_PD_SUSPENDED;
 
-	if (ps8751_flash_window_enable(me) != 0)
-		goto restore_i2c;
+	if (setup >= PS_SETUP_FLASH_UNLOCKED &&
+	    ps8751_spi_flash_lock(me) != 0)
+		status = VB2_ERROR_UNKNOWN;
+	if (setup >= PS_SETUP_I2C_SPEED &&
+	    ps8751_restore_i2c_speed(me) != 0)
+		status = VB2_ERROR_UNKNOWN;
+	if (setup >= PS_SETUP_MPU_DISABLED &&
+	    ps8751_enable_mpu(me) != 0)
+		status = VB2_ERROR_UNKNOWN;
+	if (setup >= PS_SETUP_I2C_AWAKE &&
+	    ps8751_hide_i2c(me) != 0)
+		status = VB2_ERROR_UNKNOWN;
 
-	if (ps8751_spi_flash_identify(me) == 0 &&
-	    ps8751_reflash(me, image, image_size) == 0)
-		status = 0;
+	if (ps8751_ec_pd_resume(me) != 0)
+		status = VB2_ERROR_UNKNOWN;
 
-	if (ps8751_spi_flash_lock(me) != 0)
-		status = -1;
+	/* Wait at most ~60ms for reset to occur. */
+	timeout = PS_RESTART_DELAY_CS;
+	do {
+		if (ps8751_capture_device_id(me, 1) == PS8751_DEVICE_PRESENT)
+			break;
 
- restore_i2c:
-	if (ps8751_restore_i2c_speed(me) != 0)
-		status = -1;
+		mdelay(10);
+		timeout--;
+	} while (timeout > 0);
 
- enable_mpu:
-	if (ps8751_enable_mpu(me) != 0)
-		return -1;
+	if (timeout == 0)
+		status = VB2_ERROR_UNKNOWN;
 
 	return status;
 }
 
 /*
- * update_image() is always called after check_hash(), so this function
+ * update_step() is always called after check_hash(), so this function
  * assumes that pd_suspend() has already been performed.
  */
 
-static vb2_error_t ps8751_update_image(const VbootAuxfwOps *vbaux,
+static vb2_error_t ps8751_update_begin(Ps8751 *me,
 				       const uint8_t *image, size_t image_size)
 {
-	Ps8751 *me = container_of(vbaux, Ps8751, fw_ops);
-	vb2_error_t status = VB2_ERROR_UNKNOWN;
 	int protected;
-	int timeout;
 
 	debug("call...\n");
 
+	me->update.setup = PS_SETUP_PD_SUSPENDED;
+
 	if (ps8751_check_fw_type(me, image, image_size) != 0)
 		return VB2_ERROR_UNKNOWN;
 
 	/* If the I2C tunnel is not known, probe EC for that */
 	if (!me->bus && ps8751_construct_i2c_tunnel(me)) {
 		printf("%s: Error constructing i2c tunnel\n", me->chip_name);
-		goto pd_resume;
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
 	}
 
-	if (ps8751_ec_tunnel_status(vbaux, &protected) != 0)
-		goto pd_resume;
+	if (ps8751_ec_tunnel_status(&me->fw_ops, &protected) != 0)
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
 	if (protected) {
 		/* force reboot to RO, no need for pd_resume */
 		return VB2_REQUEST_REBOOT_EC_TO_RO;
 	}
 
-	if (image == NULL || image_size == 0) {
-		status = VB2_ERROR_INVALID_PARAMETER;
-		goto pd_resume;
-	}
+	if (image == NULL || image_size == 0)
+		return ps8751_update_end(me, VB2_ERROR_INVALID_PARAMETER);
 
 	if (ps8751_wake_i2c(me) != 0)
-		goto pd_resume;
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
+	me->update.setup = PS_SETUP_I2C_AWAKE;
 
 	if (!ps8751_is_fw_compatible(me, image))
-		goto hide_i2c;
-	if (ps8751_halt_and_flash(me, image, image_size) == 0)
-		status = VB2_SUCCESS;
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
 
- hide_i2c:
-	if (ps8751_hide_i2c(me) != 0)
-		status = VB2_ERROR_UNKNOWN;
+	if (ps8751_rom_ctrl(me) != 0 ||
+	    ps8751_disable_mpu(me) != 0)
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
+	me->update.setup = PS_SETUP_MPU_DISABLED;
 
- pd_resume:
-	if (ps8751_ec_pd_resume(me) != 0)
-		status = VB2_ERROR_UNKNOWN;
+	if (ps8751_reinit_spi(me) != 0 ||
+	    ps8751_set_i2c_speed(me) != 0)
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
+	me->update.setup = PS_SETUP_I2C_SPEED;
 
-	/* Wait at most ~60ms for reset to occur. */
-	timeout = PS_RESTART_DELAY_CS;
-	do {
-		if (ps8751_capture_device_id(me, 1) == PS8751_DEVICE_PRESENT)
-			break;
+	if (ps8751_spi_flash_unlock(me) != 0)
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
+	me->update.setup = PS_SETUP_FLASH_UNLOCKED;
 
-		mdelay(10);
-		timeout--;
-	} while (timeout > 0);
+	debug("unlock_spi_bus returned\n");
 
-	if (timeout == 0)
-		status = VB2_ERROR_UNKNOWN;
+	if (ps8751_flash_window_enable(me) != 0 ||
+	    ps8751_spi_flash_identify(me) != 0 ||
+	    ps8751_reflash_check(me, image, image_size) != 0)
+		return ps8751_update_end(me, VB2_ERROR_UNKNOWN);
+
+	me->update.erase_fw = 0;
+	me->update.offset = PARADE_BOOT_HEADER_START;
+	me->update.end = PARADE_BOOT_HEADER_START + PARADE_FW_SECTOR;
+	me->update.t0_us = timer_us(0);
+	me->update.state = PS_UPDATE_ERASE;
+	return VB2_SUCCESS;
+}
+
+/*
+ * each call does one piece of the update, so flash erases on this chip
+ * can carry on while other chips are being updated.
+ */
+
+static vb2_error_t ps8751_update_step(const VbootAuxfwOps *vbaux,
+				      const uint8_t *image, size_t image_size,
+				      int *done)
+{
+	Ps8751 *me = container_of(vbaux, Ps8751, fw_ops);
+	vb2_error_t status;
+	int rv;
+
+	*done = 0;
+
+	switch (me->update.state) {
+	case PS_UPDATE_IDLE:
+		status = ps8751_update_begin(me, image, image_size);
+		if (status != VB2_SUCCESS)
+			*done = 1;
+		return status;
+	case PS_UPDATE_ERASE:
+		rv = ps8751_update_erase(me, image_size);
+		break;
+	case PS_UPDATE_ERASE_WAIT:
+		rv = ps8751_update_erase_wait(me);
+		break;
+	case PS_UPDATE_PROGRAM:
+		rv = ps8751_update_program(me, image, image_size);
+		break;
+	case PS_UPDATE_VERIFY:
+		rv = ps8751_update_verify(me, image, image_size);
+		break;
+	default:
+		rv = -1;
+		break;
+	}
+
+	if (rv == 0 && me->update.state != PS_UPDATE_DONE)
+		return VB2_SUCCESS;
+
+	*done = 1;
+	return ps8751_update_end(me, rv == 0 ? VB2_SUCCESS :
+				 VB2_ERROR_UNKNOWN);
+}
+
+static vb2_error_t ps8751_update_image(const VbootAuxfwOps *vbaux,
+				       const uint8_t *image, size_t image_size)
+{
+	vb2_error_t status;
+	int done;
+
+	do {
+		status = ps8751_update_step(vbaux, image, image_size, &done);
+	} while (status == VB2_SUCCESS && !done);
 
 	return status;
 }
@@ -1705,6 +1929,7 @@ static const VbootAuxfwOps ps8751_fw_ops = {
 	.fw_hash_name = "ps8751_a3.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8751_fw_canary_ops = {
@@ -1712,6 +1937,7 @@ static const VbootAuxfwOps ps8751_fw_canary_ops = {
 	.fw_hash_name = "ps8751_a3_canary.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8755_fw_ops = {
@@ -1719,6 +1945,7 @@ static const VbootAuxfwOps ps8755_fw_ops = {
 	.fw_hash_name = "ps8755_a2.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8705_a2_fw_ops = {
@@ -1726,6 +1953,7 @@ static const VbootAuxfwOps ps8705_a2_fw_ops = {
 	.fw_hash_name = "ps8705_a2.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8705_a3_fw_ops = {
@@ -1733,6 +1961,7 @@ static const VbootAuxfwOps ps8705_a3_fw_ops = {
 	.fw_hash_name = "ps8705_a3.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8805_a2_fw_ops = {
@@ -1740,6 +1969,7 @@ static const VbootAuxfwOps ps8805_a2_fw_ops = {
 	.fw_hash_name = "ps8805_a2.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8805_a3_fw_ops = {
@@ -1747,6 +1977,7 @@ static const VbootAuxfwOps ps8805_a3_fw_ops = {
 	.fw_hash_name = "ps8805_a3.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8815_a0_fw_ops = {
@@ -1754,6 +1985,7 @@ static const VbootAuxfwOps ps8815_a0_fw_ops = {
 	.fw_hash_name = "ps8815_a0.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8815_a1_fw_ops = {
@@ -1761,6 +1993,7 @@ static const VbootAuxfwOps ps8815_a1_fw_ops = {
 	.fw_hash_name = "ps8815_a1.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8815_a2_fw_ops = {
@@ -1768,6 +2001,7 @@ static const VbootAuxfwOps ps8815_a2_fw_ops = {
 	.fw_hash_name = "ps8815_a2.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static const VbootAuxfwOps ps8745_a2_fw_ops = {
@@ -1775,6 +2009,7 @@ static const VbootAuxfwOps ps8745_a2_fw_ops = {
 	.fw_hash_name = "ps8745_a2.hash",
 	.check_hash = ps8751_check_hash,
 	.update_image = ps8751_update_image,
+	.update_step = ps8751_update_step,
 };
 
 static void ps8751_init_flash_ops(Ps8751 *me)
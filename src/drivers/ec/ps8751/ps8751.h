@@ -44,6 +44,25 @@ typedef enum ParadeFwType {
 	PARADE_FW_APP,
 } ParadeFwType;
 
+/* Where an update run through update_step has got to. */
+typedef enum Ps8751UpdateState {
+	PS_UPDATE_IDLE,
+	PS_UPDATE_ERASE,	/* start erasing the next sector */
+	PS_UPDATE_ERASE_WAIT,	/* wait for the sector erase to finish */
+	PS_UPDATE_PROGRAM,	/* program the next chunk */
+	PS_UPDATE_VERIFY,	/* verify what was programmed */
+	PS_UPDATE_DONE,
+} Ps8751UpdateState;
+
+/* Chip setup done for an update, undone in reverse when it ends. */
+typedef enum Ps8751UpdateSetup {
+	PS_SETUP_PD_SUSPENDED,
+	PS_SETUP_I2C_AWAKE,
+	PS_SETUP_MPU_DISABLED,
+	PS_SETUP_I2C_SPEED,
+	PS_SETUP_FLASH_UNLOCKED,
+} Ps8751UpdateSetup;
+
 typedef struct Ps8751 {
 	VbootAuxfwOps fw_ops;
 	CrosECTunnelI2c *bus;
@@ -123,6 +142,19 @@ typedef struct Ps8751 {
 	 */
 	int (*flash_write_disable)(struct Ps8751 *me);
 
+	/* progress of an update run through update_step */
+	struct {
+		Ps8751UpdateState state;
+		Ps8751UpdateSetup setup;
+		int erase_fw;		/* past the boot header sector */
+		uint32_t offset;	/* next flash/image offset */
+		uint32_t end;		/* end of the erase range */
+		int bytes_skipped;
+		uint64_t t0_us;		/* start of the erase or program */
+		uint64_t wait_us;	/* start of the sector erase */
+		uint64_t poll_us;	/* last erase status poll */
+	} update;
+
 	/* Used for DRIVER_EC_PS8751_I2C_SPEED_CONTROL. */
 	uint16_t saved_i2c_speed_khz;
 
@@ -42,11 +42,11 @@ static ssize_t __must_check ps8751_flash_fifo_read(Ps8751 *me,
 	if (ps8751_spi_fifo_wait_busy(me) != 0)
 		return -1;
 
-	for (int i = 0; i < chunk; ++i) {
-		if (ps8751_read_reg(me, me->addr_page_2,
-				    P2_RD_FIFO, &data[i]) != 0)
-			return -1;
-	}
+	/* drain the whole FIFO in as few tunnel commands as possible */
+	uint8_t regs[PS_FW_RD_CHUNK];
+	memset(regs, P2_RD_FIFO, sizeof(regs));
+	if (ps8751_read_regs(me, me->addr_page_2, regs, chunk, data) != 0)
+		return -1;
 
 	return chunk;
 }
@@ -75,19 +75,17 @@ static ssize_t __must_check ps8751_flash_fifo_write(Ps8751 *me,
 	if (ps8751_spi_setup_cmd24(me, SPI_CMD_PROG_PAGE, a24) != 0)
 		return -1;
 
+	/* fill the FIFO and trigger the write in one go */
+	I2cWriteVec wr[PS_FW_WR_CHUNK + 2];
 	for (int i = 0; i < chunk; ++i) {
-		if (ps8751_write_reg(me, me->addr_page_2,
-				     P2_WR_FIFO, data[i]) != 0)
-			return -1;
+		wr[i].reg = P2_WR_FIFO;
+		wr[i].val = data[i];
 	}
-
-	const I2cWriteVec wr[] = {
-		{ P2_SPI_LEN, (4 + chunk - 1) },
-		{ P2_SPI_CTRL,
-		  P2_SPI_CTRL_NOREAD|P2_SPI_CTRL_TRIGGER },
-	};
-	if (ps8751_write_regs(me, me->addr_page_2,
-			      wr, ARRAY_SIZE(wr)) != 0)
+	wr[chunk].reg = P2_SPI_LEN;
+	wr[chunk].val = 4 + chunk - 1;
+	wr[chunk + 1].reg = P2_SPI_CTRL;
+	wr[chunk + 1].val = P2_SPI_CTRL_NOREAD|P2_SPI_CTRL_TRIGGER;
+	if (ps8751_write_regs(me, me->addr_page_2, wr, chunk + 2) != 0)
 		return -1;
 	if (ps8751_spi_fifo_wait_busy(me) != 0)
 		return -1;
@@ -23,7 +23,15 @@ static int __must_check read_block(Ps8751 *me,
 				   uint8_t page, uint8_t reg,
 				   uint8_t *data, size_t count)
 {
-	return i2c_readblock(&me->bus->ops, page, reg, data, count);
+	I2cSeg seg[] = {
+		{ .read = 0, .chip = page, .buf = &reg, .len = 1 },
+		{ .read = 1, .chip = page, .buf = data, .len = count },
+	};
+
+	/* goes out together with any queued window address writes */
+	if (cros_ec_tunnel_i2c_batch(me->bus, seg, ARRAY_SIZE(seg)) != 0)
+		return -1;
+	return cros_ec_tunnel_i2c_flush(me->bus) ? -1 : 0;
 }
 
 /**
@@ -41,7 +49,16 @@ static int __must_check write_block(Ps8751 *me,
 				    uint8_t page, uint8_t reg,
 				    const uint8_t *data, size_t count)
 {
-	return i2c_writeblock(&me->bus->ops, page, reg, data, count);
+	uint8_t buf[count + 1];
+	I2cSeg seg = { .read = 0, .chip = page, .buf = buf, .len = count + 1 };
+
+	buf[0] = reg;
+	memcpy(buf + 1, data, count);
+
+	/* goes out together with any queued window address writes */
+	if (cros_ec_tunnel_i2c_batch(me->bus, &seg, 1) != 0)
+		return -1;
+	return cros_ec_tunnel_i2c_flush(me->bus) ? -1 : 0;
 }
 
 /**
@@ -55,6 +72,28 @@ static void ps8751_flash_window_start(Ps8751 *me)
 	me->last_a8_a15 = -1;
 }
 
+/**
+ * Queue writes of the flash window address registers that differ from
+ * the cached values. The cache is only updated by the caller once the
+ * queued writes have been flushed successfully.
+ */
+
+static int __must_check queue_window_addr(Ps8751 *me,
+					  uint8_t a16_a23, uint8_t a8_a15)
+{
+	if (a16_a23 != me->last_a16_a23 &&
+	    ps8751_queue_write_reg(me, me->addr_page_2,
+				   P2_FLASH_A16_A23, a16_a23) != 0)
+		return -1;
+
+	if (a8_a15 != me->last_a8_a15 &&
+	    ps8751_queue_write_reg(me, me->addr_page_2,
+				   P2_FLASH_A8_A15, a8_a15) != 0)
+		return -1;
+
+	return 0;
+}
+
 _Static_assert(PS_FW_I2C_WINDOW_SIZE == 256,
 	       "PS8xxx flash access window size "
 	       "over I2C is expected to be 256 bytes.");
@@ -82,23 +121,14 @@ static ssize_t __must_check ps8751_flash_window_read(Ps8751 *me,
 	/* clip at I2C window boundary */
 	chunk = MIN(chunk, PS_FW_I2C_WINDOW_SIZE - a0_a7);
 
-	if (a16_a23 != me->last_a16_a23) {
-		if (ps8751_write_reg(me,
-				     me->addr_page_2,
-				     P2_FLASH_A16_A23, a16_a23) != 0)
-			return -1;
-		me->last_a16_a23 = a16_a23;
-	}
-
-	if (a8_a15 != me->last_a8_a15) {
-		if (ps8751_write_reg(me, me->addr_page_2,
-				     P2_FLASH_A8_A15, a8_a15) != 0)
-			return -1;
-		me->last_a8_a15 = a8_a15;
-	}
-
-	if (read_block(me, me->addr_page_7, a0_a7, data, chunk) != 0)
+	if (queue_window_addr(me, a16_a23, a8_a15) != 0 ||
+	    read_block(me, me->addr_page_7, a0_a7, data, chunk) != 0) {
+		/* window address registers are now unknown */
+		ps8751_flash_window_start(me);
 		return -1;
+	}
+	me->last_a16_a23 = a16_a23;
+	me->last_a8_a15 = a8_a15;
 
 	return chunk;
 }
@@ -126,23 +156,14 @@ static ssize_t __must_check ps8751_flash_window_write(Ps8751 *me,
 	/* clip at I2C window boundary */
 	chunk = MIN(chunk, PS_FW_I2C_WINDOW_SIZE - a0_a7);
 
-	if (a16_a23 != me->last_a16_a23) {
-		if (ps8751_write_reg(me,
-				     me->addr_page_2,
-				     P2_FLASH_A16_A23, a16_a23) != 0)
-			return -1;
-		me->last_a16_a23 = a16_a23;
-	}
-
-	if (a8_a15 != me->last_a8_a15) {
-		if (ps8751_write_reg(me, me->addr_page_2,
-				     P2_FLASH_A8_A15, a8_a15) != 0)
-			return -1;
-		me->last_a8_a15 = a8_a15;
-	}
-
-	if (write_block(me, me->addr_page_7, a0_a7, data, chunk) != 0)
+	if (queue_window_addr(me, a16_a23, a8_a15) != 0 ||
+	    write_block(me, me->addr_page_7, a0_a7, data, chunk) != 0) {
+		/* window address registers are now unknown */
+		ps8751_flash_window_start(me);
 		return -1;
+	}
+	me->last_a16_a23 = a16_a23;
+	me->last_a8_a15 = a8_a15;
 
 	return chunk;
 }
@@ -154,6 +154,7 @@
 
 #define PS_SPI_TIMEOUT_US	(1 * 1000 * 1000)	/* 1s */
 #define PS_WIP_TIMEOUT_US	(1 * 1000 * 1000)	/* 1s */
+#define PS_ERASE_POLL_US	(10 * 1000)		/* 10ms */
 
 #define PS_I2C_WINDOW_SPEED_KHZ	400
 
@@ -193,6 +194,19 @@ int __must_check ps8751_read_regs(Ps8751 *me, uint8_t chip, const uint8_t *regs,
 int __must_check ps8751_write_reg(Ps8751 *me, uint8_t page, uint8_t reg,
 				  uint8_t data);
 
+/**
+ * queue a write of a single byte to a register of an i2c page. it goes
+ * out in the same EC tunnel command as the next flushing access.
+ *
+ * @param me	device context
+ * @param page	i2c device address
+ * @param reg	i2c register on target device
+ * @param data	byte to write to register
+ * @return 0 if ok, -1 on error
+ */
+int __must_check ps8751_queue_write_reg(Ps8751 *me, uint8_t page,
+					uint8_t reg, uint8_t data);
+
 /**
  * issue a series of i2c writes
  *
@@ -18,6 +18,7 @@
 #include <vb2_api.h>
 #include <vboot_api.h>
 
+#include "base/timestamp.h"
 #include "drivers/ec/cros/ec.h"
 #include "drivers/ec/vboot_auxfw.h"
 #include "vboot/ui.h"
@@ -25,6 +26,10 @@
 static struct {
 	const VbootAuxfwOps *fw_ops;
 	enum vb2_auxfw_update_severity severity;
+	/* image being applied with update_step, NULL if none */
+	uint8_t *image;
+	size_t image_size;
+	uint64_t start_us;
 } vboot_auxfw[NUM_MAX_VBOOT_AUXFW];
 
 static int vboot_auxfw_count = 0;
@@ -128,6 +133,25 @@ static vb2_error_t display_firmware_sync_screen(void)
 	return VB2_SUCCESS;
 }
 
+/**
+ * Load the device firmware update from CBFS.
+ *
+ * @param auxfw		FW device ops
+ * @param size		return parameter for the image size
+ * @return the image, which the caller must free, or NULL if missing.
+ */
+static uint8_t *map_dev_fw(const VbootAuxfwOps *auxfw, size_t *size)
+{
+	uint8_t *want_data;
+
+	/* find bundled fw */
+	want_data = cbfs_map(auxfw->fw_image_name, size);
+	if (want_data == NULL)
+		printf("%s missing from CBFS\n", auxfw->fw_image_name);
+
+	return want_data;
+}
+
 /**
  * Apply the device firmware update.
  *
@@ -140,12 +164,9 @@ static vb2_error_t apply_dev_fw(const VbootAuxfwOps *auxfw)
 	size_t want_size;
 	vb2_error_t result;
 
-	/* find bundled fw */
-	want_data = cbfs_map(auxfw->fw_image_name, &want_size);
-	if (want_data == NULL) {
-		printf("%s missing from CBFS\n", auxfw->fw_image_name);
+	want_data = map_dev_fw(auxfw, &want_size);
+	if (want_data == NULL)
 		return VB2_ERROR_UNKNOWN;
-	}
 
 	result = auxfw->update_image(auxfw, want_data, want_size);
 	free(want_data);
@@ -153,14 +174,87 @@ static vb2_error_t apply_dev_fw(const VbootAuxfwOps *auxfw)
 	return result;
 }
 
-vb2_error_t update_vboot_auxfw(void)
+/**
+ * Check the outcome of a device firmware update.
+ *
+ * @param auxfw		FW device ops
+ * @param status	what the update returned
+ * @return VB2_SUCCESS, or non-zero if error.
+ */
+static vb2_error_t finish_dev_fw(const VbootAuxfwOps *auxfw,
+				 vb2_error_t status)
 {
 	enum vb2_auxfw_update_severity severity;
+
+	if (status == VB2_ERROR_EX_AUXFW_PERIPHERAL_BUSY)
+		return VB2_SUCCESS;
+	if (status != VB2_SUCCESS)
+		return status;
+
+	/* Re-check hash after update */
+	status = check_dev_fw_hash(auxfw, &severity);
+	if (status != VB2_SUCCESS)
+		return status;
+	if (severity != VB2_AUXFW_NO_UPDATE)
+		return VB2_ERROR_UNKNOWN;
+
+	return VB2_SUCCESS;
+}
+
+/**
+ * Run the updates started with update_step until they have all finished,
+ * giving each one a turn in order so that their waits overlap.
+ *
+ * @param pending	number of updates in progress
+ * @return VB2_SUCCESS, or the first error seen.
+ */
+static vb2_error_t step_dev_fw(int pending)
+{
+	vb2_error_t status = VB2_SUCCESS;
+
+	while (pending > 0) {
+		for (int i = 0; i < vboot_auxfw_count; ++i) {
+			const VbootAuxfwOps *auxfw = vboot_auxfw[i].fw_ops;
+			vb2_error_t result;
+			int done = 0;
+
+			if (!vboot_auxfw[i].image)
+				continue;
+
+			result = auxfw->update_step(auxfw,
+						    vboot_auxfw[i].image,
+						    vboot_auxfw[i].image_size,
+						    &done);
+			if (result == VB2_SUCCESS && !done)
+				continue;
+
+			free(vboot_auxfw[i].image);
+			vboot_auxfw[i].image = NULL;
+			pending--;
+
+			printf("auxfw %d update took %llums\n", i,
+			       timer_us(vboot_auxfw[i].start_us) /
+			       USECS_PER_MSEC);
+
+			result = finish_dev_fw(auxfw, result);
+			if (status == VB2_SUCCESS)
+				status = result;
+		}
+	}
+
+	return status;
+}
+
+vb2_error_t update_vboot_auxfw(void)
+{
 	vb2_error_t status = VB2_SUCCESS;
 	int lid_shutdown_disabled = 0;
+	int pending = 0;
 
 	VB2_TRY(display_firmware_sync_screen());
 
+	timestamp_add_now(TS_VB_AUXFW_UPDATE_START);
+
 	for (int i = 0; i < vboot_auxfw_count; ++i) {
 		const VbootAuxfwOps *auxfw;
 
@@ -178,27 +272,40 @@ vb2_error_t update_vboot_auxfw(void)
 					lid_shutdown_disabled = 1;
 			}
 
-			/* Apply update */
 			printf("Update auxfw %d\n", i);
-			status = apply_dev_fw(auxfw);
-			if (status == VB2_ERROR_EX_AUXFW_PERIPHERAL_BUSY) {
-				status = VB2_SUCCESS;
+			vboot_auxfw[i].start_us = timer_us(0);
+
+			/* Resumable updates run together below */
+			if (auxfw->update_step) {
+				vboot_auxfw[i].image = map_dev_fw(
+					auxfw, &vboot_auxfw[i].image_size);
+				if (!vboot_auxfw[i].image) {
+					status = VB2_ERROR_UNKNOWN;
+					break;
+				}
+				pending++;
 				continue;
-			} else if (status != VB2_SUCCESS) {
-				break;
 			}
 
-			/* Re-check hash after update */
-			status = check_dev_fw_hash(auxfw, &severity);
+			/* Apply update */
+			status = finish_dev_fw(auxfw, apply_dev_fw(auxfw));
 			if (status != VB2_SUCCESS)
 				break;
-			if (severity != VB2_AUXFW_NO_UPDATE) {
-				status = VB2_ERROR_UNKNOWN;
-				break;
-			}
 		}
 	}
 
+	if (status == VB2_SUCCESS) {
+		status = step_dev_fw(pending);
+	} else {
+		/* Don't start the remaining updates */
+		for (int i = 0; i < vboot_auxfw_count; ++i) {
+			free(vboot_auxfw[i].image);
+			vboot_auxfw[i].image = NULL;
+		}
+	}
+
+	timestamp_add_now(TS_VB_AUXFW_UPDATE_END);
+
 	/* Re-enable lid shutdown event, if required */
 	if (CONFIG(DRIVER_EC_CROS) && lid_shutdown_disabled)
 		cros_ec_set_lid_shutdown_mask(1);
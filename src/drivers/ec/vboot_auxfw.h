@@ -33,11 +33,22 @@ struct VbootAuxfwOps {
 	 */
 	vb2_error_t (*update_image)(const VbootAuxfwOps *me,
 				  const uint8_t *image, size_t image_size);
+	/*
+	 * Optional resumable form of update_image. Each call does a short
+	 * piece of the update and, rather than waiting for the chip to
+	 * finish an erase or program, returns so that other chips can be
+	 * worked on in the meantime. Sets *done once the update is over,
+	 * whether it succeeded or not; an error return also ends the
+	 * update. The same image is passed to every call.
+	 */
+	vb2_error_t (*update_step)(const VbootAuxfwOps *me,
+				   const uint8_t *image, size_t image_size,
+				   int *done);
 	const char *fw_image_name;
 	const char *fw_hash_name;
 };
 
-#define NUM_MAX_VBOOT_AUXFW 2
+#define NUM_MAX_VBOOT_AUXFW 4
 
 /**
  * Register a new firmware updater. The check_hash and update_image callbacks
@@ -60,8 +71,9 @@ vb2_error_t check_vboot_auxfw(enum vb2_auxfw_update_severity *severity);
 
 /**
  * Iterate over registered firmware updaters and apply updates where needed.
- * check_vboot_auxfw() must have been called before this to determine what
- * needs to be updated.
+ * Updaters with an update_step callback are run round-robin, so they are
+ * updated side by side. check_vboot_auxfw() must have been called before
+ * this to determine what needs to be updated.
  *
  * @return VB2_SUCCESS, or non-zero if error.
  */
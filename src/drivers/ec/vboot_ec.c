@@ -29,4 +29,8 @@ void register_vboot_ec(VbootEcOps *ec)
 	assert(!vboot_ec);
 
 	vboot_ec = ec;
+
+	/* Boards register the EC early on, well before software sync. */
+	if (ec->start_hash)
+		ec->start_hash(ec);
 }
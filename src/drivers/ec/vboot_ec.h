@@ -57,6 +57,12 @@ typedef struct VbootEcOps {
 	 * before invoking it.
 	 */
 	vb2_error_t (*protect_tcpc_ports)(struct VbootEcOps *me);
+
+	/*
+	 * Get the EC working on the hash that hash_image will ask for, so it
+	 * is ready by then. Optional, called by register_vboot_ec.
+	 */
+	void (*start_hash)(struct VbootEcOps *me);
 } VbootEcOps;
 
 /*
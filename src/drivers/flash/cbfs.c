@@ -18,15 +18,105 @@
 #include <cbfs.h>
 #include <libpayload.h>
 
+#include "drivers/flash/cbfs.h"
 #include "drivers/flash/flash.h"
 
+/*
+ * libcbfs walks the file headers from the start of a region for every
+ * lookup. Remember the metadata it reads, indexed by flash offset, so that
+ * later lookups in the same boot don't go back to flash. The walk itself,
+ * including any metadata hash verification, still runs over the same bytes.
+ *
+ * Only file headers and the name and attributes read right after them are
+ * kept, so the directory is bounded by the number of files. They are read
+ * around the flash read cache, which would only hold a second copy.
+ */
+typedef struct CbfsMdataEntry {
+	struct CbfsMdataEntry *next;
+	uint32_t offset;
+	uint32_t size;
+	uint8_t data[];
+} CbfsMdataEntry;
+
+#define CBFS_MDATA_BUCKETS 64
+
+static CbfsMdataEntry *cbfs_mdata_dir[CBFS_MDATA_BUCKETS];
+
+/* Where the rest of the metadata of the last file header read starts. */
+static size_t cbfs_mdata_next = SIZE_MAX;
+
+static CbfsMdataEntry **cbfs_mdata_bucket(uint32_t offset)
+{
+	/* A file's header and name are in the same CBFS_ALIGNMENT chunk. */
+	return &cbfs_mdata_dir[(offset / CBFS_ALIGNMENT) % CBFS_MDATA_BUCKETS];
+}
+
+static int cbfs_is_mdata_read(size_t offset, size_t size)
+{
+	size_t next = cbfs_mdata_next;
+
+	/* libcbfs reads a header, then the rest of the metadata after it. */
+	cbfs_mdata_next = SIZE_MAX;
+	if (size == sizeof(struct cbfs_file) &&
+	    IS_ALIGNED(offset, CBFS_ALIGNMENT)) {
+		cbfs_mdata_next = offset + size;
+		return 1;
+	}
+	return offset == next &&
+	       size <= sizeof(union cbfs_mdata) - sizeof(struct cbfs_file);
+}
+void cbfs_flash_invalidate(uint32_t offset, uint32_t size)
+{
+	for (int i = 0; i < CBFS_MDATA_BUCKETS; i++) {
+		CbfsMdataEntry **link = &cbfs_mdata_dir[i];
+
+		while (*link) {
+			CbfsMdataEntry *entry = *link;
+
+			if (entry->offset < offset + size &&
+			    offset < entry->offset + entry->size) {
+				*link = entry->next;
+				free(entry);
+			} else {
+				link = &entry->next;
+			}
+		}
+	}
+}
+
 /* Function required by libpayload libcbfs implementation to access CBFS */
 ssize_t boot_device_read(void *buf, size_t offset, size_t size)
 {
+	CbfsMdataEntry **bucket = cbfs_mdata_bucket(offset);
+	CbfsMdataEntry *entry;
+	int rv;
+
+	/* File data is read once, or small enough for the flash cache. */
+	if (!cbfs_is_mdata_read(offset, size)) {
+		rv = flash_read(buf, offset, size);
+		return rv < 0 ? CB_ERR : rv;
+	}
+
+	for (entry = *bucket; entry; entry = entry->next) {
+		if (entry->offset == offset && entry->size == size) {
+			memcpy(buf, entry->data, size);
+			return size;
+		}
+	}
+
 	/* buffer passed by the API should not be affected on error */
-	int rv = flash_read(buf, offset, size);
+	rv = flash_read_direct(buf, offset, size);
 
 	if (rv < 0)
 		return CB_ERR;
+
+	if (rv == size) {
+		entry = xmalloc(sizeof(*entry) + size);
+		entry->offset = offset;
+		entry->size = size;
+		memcpy(entry->data, buf, size);
+		entry->next = *bucket;
+		*bucket = entry;
+	}
 	return rv;
 }
@@ -0,0 +1,22 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __DRIVERS_FLASH_CBFS_H__
+#define __DRIVERS_FLASH_CBFS_H__
+
+#include <stdint.h>
+
+/* Forget any CBFS metadata remembered from this range of flash. */
+void cbfs_flash_invalidate(uint32_t offset, uint32_t size);
+
+#endif /* __DRIVERS_FLASH_CBFS_H__ */
@@ -184,7 +184,7 @@ static int fast_spi_flash_read(FlashOps *me, void *buffer, uint32_t offset,
 		uintptr_t mmio_address =
 			(uintptr_t)(flash->mmio_address -
 				    flash->mmio_offset + offset);
-		memcpy(buffer, (void *)mmio_address, size);
+		flash_mmio_copy(buffer, (void *)mmio_address, size);
 
 		return size;
 	}
@@ -343,6 +343,7 @@ FastSpiFlash *new_fast_spi_flash(uintptr_t mmio_base)
 	flash->ops.read_status = fast_spi_flash_read_status;
 	flash->ops.write_status = fast_spi_flash_write_status;
 	flash->ops.read_id = fast_spi_flash_read_id;
+	flash->ops.program_without_erase = 1;
 
 	fast_spi_fill_regions(flash);
 
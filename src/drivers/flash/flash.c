@@ -17,8 +17,55 @@
 
 #include <libpayload.h>
 
+#include "base/cleanup_funcs.h"
+#include "drivers/flash/cbfs.h"
 #include "drivers/flash/flash.h"
 
+#define FLASH_CACHE_BLOCK_SIZE (4 * KiB)
+#define FLASH_CACHE_BLOCKS (CONFIG_DRIVER_FLASH_CACHE_SIZE / \
+			    FLASH_CACHE_BLOCK_SIZE)
+/* Bigger reads bypass the cache so they don't evict all the metadata. */
+#define FLASH_CACHE_MAX_READ (CONFIG_DRIVER_FLASH_CACHE_SIZE / 4)
+
+/* The usual SPI NOR block erase size. */
+#define FLASH_REWRITE_CHUNK_SIZE (64 * KiB)
+
+typedef struct FlashCacheBlock {
+	uint8_t *data;
+	uint32_t offset;
+	int valid;
+	/* Value of flash_cache_clock when this block was last used. */
+	uint32_t last_used;
+} FlashCacheBlock;
+
+static FlashCacheBlock *flash_cache;
+static uint32_t flash_cache_clock;
+
+/*
+ * Bytes asked for through flash_read(), bytes read from the device, and
+ * the time it all took.
+ */
+static uint64_t flash_bytes_requested;
+static uint64_t flash_bytes_transferred;
+static uint64_t flash_read_us;
+
+static void flash_cache_invalidate(uint32_t offset, uint32_t size)
+{
+	if (CONFIG(DRIVER_CBFS_FLASH))
+		cbfs_flash_invalidate(offset, size);
+
+	if (!flash_cache)
+		return;
+
+	for (int i = 0; i < FLASH_CACHE_BLOCKS; i++) {
+		FlashCacheBlock *block = &flash_cache[i];
+
+		if (block->offset < offset + size &&
+		    offset < block->offset + FLASH_CACHE_BLOCK_SIZE)
+			block->valid = 0;
+	}
+}
+
 int __must_check flash_read_ops(FlashOps *ops, void *buffer, uint32_t offset,
 				uint32_t size)
 {
@@ -30,6 +77,11 @@ int __must_check flash_write_ops(FlashOps *ops, const void *buffer,
 				 uint32_t offset, uint32_t size)
 {
 	die_if(!ops, "%s: No flash ops set.\n", __func__);
+	/*
+	 * The same chip may be behind more than one FlashOps, so don't bother
+	 * checking whether these are the ones being cached.
+	 */
+	flash_cache_invalidate(offset, size);
 	if (ops->write)
 		return ops->write(ops, buffer, offset, size);
 
@@ -39,12 +91,60 @@ int __must_check flash_write_ops(FlashOps *ops, const void *buffer,
 int __must_check flash_erase_ops(FlashOps *ops, uint32_t offset, uint32_t size)
 {
 	die_if(!ops, "%s: No flash ops set.\n", __func__);
+	flash_cache_invalidate(offset, size);
 	if (ops->erase)
 		return ops->erase(ops, offset, size);
 
 	return 0;
 }
 
+/* Stores to the destination buffer, which may not be aligned. */
+struct flash_mmio_word {
+	unsigned long v;
+} __attribute__((packed));
+
+void flash_mmio_copy(void *dest, const void *src, uint32_t size)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dest;
+	const size_t word = sizeof(unsigned long);
+
+	/*
+	 * Reads from a flash window that isn't cached can turn into a bus
+	 * transaction per load, so use aligned word loads and don't leave
+	 * it up to memcpy() how wide they are.
+	 */
+	while (size && !IS_ALIGNED((uintptr_t)s, word)) {
+		*d++ = *(const volatile uint8_t *)s++;
+		size--;
+	}
+
+	while (size >= 4 * word) {
+		const volatile unsigned long *w = (const void *)s;
+		unsigned long w0 = w[0], w1 = w[1], w2 = w[2], w3 = w[3];
+		struct flash_mmio_word *out = (void *)d;
+
+		out[0].v = w0;
+		out[1].v = w1;
+		out[2].v = w2;
+		out[3].v = w3;
+		s += 4 * word;
+		d += 4 * word;
+		size -= 4 * word;
+	}
+
+	while (size >= word) {
+		((struct flash_mmio_word *)d)->v =
+			*(const volatile unsigned long *)s;
+		s += word;
+		d += word;
+		size -= word;
+	}
+
+	while (size--)
+		*d++ = *(const volatile uint8_t *)s++;
+}
+
 static inline int flash_write_status_ops(FlashOps *ops, uint8_t status)
 {
 	die_if(!ops, "%s: No flash ops set.\n", __func__);
@@ -80,58 +180,267 @@ static inline uint32_t flash_sector_size_ops(FlashOps *ops)
 	return ops->sector_size;
 }
 
-int __must_check flash_rewrite_ops(FlashOps *ops, const void *buffer,
-				   uint32_t start, uint32_t length)
+/* Whether turning old into new needs any 0 bits set back to 1. */
+static int flash_needs_erase(const uint8_t *old, const uint8_t *new,
+			     uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++)
+		if ((old[i] & new[i]) != new[i])
+			return 1;
+	return 0;
+}
+
+/* Whether a changed sector has to be erased before it can be written. */
+static int flash_sector_needs_erase(FlashOps *ops, const uint8_t *old,
+				    const uint8_t *new, uint32_t size)
+{
+	if (!ops->program_without_erase)
+		return memcmp(old, new, size) != 0;
+	return flash_needs_erase(old, new, size);
+}
+
+/* Program the bytes of new which differ from what's on the flash (cur). */
+static int flash_program_diff(FlashOps *ops, const uint8_t *cur,
+			      const uint8_t *new, uint32_t offset,
+			      uint32_t size)
+{
+	uint32_t first = 0, last = size;
+	int ret;
+
+	while (first < last && cur[first] == new[first])
+		first++;
+	while (last > first && cur[last - 1] == new[last - 1])
+		last--;
+	if (first == last)
+		return 0;
+
+	ret = flash_write_ops(ops, new + first, offset + first, last - first);
+	if (ret != last - first) {
+		printf("rewriting failed in write ret=%d\n", ret);
+		return -1;
+	}
+	return 0;
+}
+
+static int flash_rewrite_chunk(FlashOps *ops, uint8_t *old, uint8_t *new,
+			       const uint8_t *buffer, uint32_t start,
+			       uint32_t length, uint32_t offset, uint32_t size)
 {
 	uint32_t sector_size = flash_sector_size_ops(ops);
-	uint32_t initial_start = ALIGN_DOWN(start, sector_size);
-	uint32_t final_end = ALIGN_UP(start + length, sector_size);
-	uint32_t full_length = final_end - initial_start;
-	void *dev_buffer = NULL;
-	int result = -1;
+	uint32_t copy_start = MAX(start, offset);
+	uint32_t copy_end = MIN(start + length, offset + size);
+	uint32_t i, run_end;
 	int ret;
 
-	if (initial_start != start || final_end != full_length) {
-		dev_buffer = xzalloc(full_length);
-		ret = flash_read_ops(ops, dev_buffer, initial_start,
-				     full_length);
-		if (ret != full_length) {
-			printf("rewriting failed in read ret=%d\n", ret);
-			goto end;
-		}
-		memcpy(dev_buffer + (start - initial_start), buffer, length);
-		buffer = dev_buffer;
+	ret = flash_read_ops(ops, old, offset, size);
+	if (ret != size) {
+		printf("rewriting failed in read ret=%d\n", ret);
+		return -1;
 	}
+	memcpy(new, old, size);
+	memcpy(new + copy_start - offset, buffer + copy_start - start,
+	       copy_end - copy_start);
 
-	ret = flash_erase_ops(ops, initial_start, full_length);
-	if (ret != full_length) {
-		printf("rewriting SPI GPT failed in erase ret=%d\n", ret);
-		goto end;
+	/*
+	 * Erase runs of sectors with a single call so the driver can use
+	 * block erases where they line up.
+	 */
+	for (i = 0; i < size; i = run_end) {
+		run_end = i + sector_size;
+		if (!flash_sector_needs_erase(ops, old + i, new + i,
+					      sector_size))
+			continue;
+		while (run_end < size &&
+		       flash_sector_needs_erase(ops, old + run_end,
+						new + run_end, sector_size))
+			run_end += sector_size;
+
+		ret = flash_erase_ops(ops, offset + i, run_end - i);
+		if (ret != run_end - i) {
+			printf("rewriting failed in erase ret=%d\n", ret);
+			return -1;
+		}
+
+		if (ops->program_without_erase) {
+			memset(old + i, 0xff, run_end - i);
+			continue;
+		}
+		ret = flash_write_ops(ops, new + i, offset + i, run_end - i);
+		if (ret != run_end - i) {
+			printf("rewriting failed in write ret=%d\n", ret);
+			return -1;
+		}
 	}
 
-	ret = flash_write_ops(ops, buffer, initial_start, full_length);
-	if (ret != full_length) {
-		printf("rewriting failed in write ret=%d\n", ret);
-		goto end;
+	if (!ops->program_without_erase)
+		return 0;
+
+	/*
+	 * What's left only clears bits, which can be programmed directly.
+	 * Sectors which haven't changed are skipped.
+	 */
+	for (i = 0; i < size; i += sector_size)
+		if (flash_program_diff(ops, old + i, new + i, offset + i,
+				       sector_size))
+			return -1;
+
+	return 0;
+}
+
+int __must_check flash_rewrite_ops(FlashOps *ops, const void *buffer,
+				   uint32_t start, uint32_t length)
+{
+	uint32_t sector_size = flash_sector_size_ops(ops);
+	uint32_t chunk_size = MAX(FLASH_REWRITE_CHUNK_SIZE, sector_size);
+	uint32_t pos = ALIGN_DOWN(start, sector_size);
+	uint32_t end = ALIGN_UP(start + length, sector_size);
+	uint8_t *old = xmalloc(chunk_size);
+	uint8_t *new = xmalloc(chunk_size);
+	int result = -1;
+
+	/*
+	 * Go one erase block at a time, so big rewrites don't need big
+	 * buffers.
+	 */
+	while (pos < end) {
+		uint32_t chunk_end = MIN(ALIGN_DOWN(pos, chunk_size) +
+					 chunk_size, end);
+
+		if (flash_rewrite_chunk(ops, old, new, buffer, start, length,
+					pos, chunk_end - pos))
+			goto end;
+		pos = chunk_end;
 	}
 
 	result = length;
 end:
-	free(dev_buffer);
+	free(old);
+	free(new);
 	return result;
 }
 
 static FlashOps *flash_ops;
 
+static int flash_print_stats(CleanupFunc *cleanup, CleanupType type)
+{
+	printf("Flash reads: %llu bytes requested, %llu bytes transferred "
+	       "in %llu us.\n", flash_bytes_requested,
+	       flash_bytes_transferred, flash_read_us);
+	return 0;
+}
+
+static CleanupFunc flash_stats_cleanup = {
+	.cleanup = &flash_print_stats,
+	.types = CleanupOnHandoff | CleanupOnLegacy,
+};
+
 void flash_set_ops(FlashOps *ops)
 {
 	die_if(flash_ops, "Flash ops already set.\n");
 	flash_ops = ops;
+
+	list_insert_after(&flash_stats_cleanup.list_node, &cleanup_funcs);
+}
+
+static int flash_read_uncached(void *buffer, uint32_t offset, uint32_t size)
+{
+	int ret = flash_read_ops(flash_ops, buffer, offset, size);
+
+	if (ret > 0)
+		flash_bytes_transferred += ret;
+	return ret;
+}
+
+/* Find the cache block starting at offset, reading it in if necessary. */
+static FlashCacheBlock *flash_cache_get(uint32_t offset)
+{
+	FlashCacheBlock *victim = NULL;
+
+	if (!flash_cache)
+		flash_cache = xzalloc(FLASH_CACHE_BLOCKS *
+				      sizeof(*flash_cache));
+
+	for (int i = 0; i < FLASH_CACHE_BLOCKS; i++) {
+		FlashCacheBlock *block = &flash_cache[i];
+
+		if (block->valid && block->offset == offset) {
+			block->last_used = ++flash_cache_clock;
+			return block;
+		}
+		/* Prefer an unused block, otherwise the least recently used. */
+		if (!victim || (victim->valid && (!block->valid ||
+		    block->last_used < victim->last_used)))
+			victim = block;
+	}
+
+	if (!victim->data)
+		victim->data = xmalloc(FLASH_CACHE_BLOCK_SIZE);
+	victim->valid = 0;
+	if (flash_read_uncached(victim->data, offset,
+				FLASH_CACHE_BLOCK_SIZE) !=
+	    FLASH_CACHE_BLOCK_SIZE)
+		return NULL;
+
+	victim->offset = offset;
+	victim->valid = 1;
+	victim->last_used = ++flash_cache_clock;
+	return victim;
+}
+
+static int flash_cache_read(void *buffer, uint32_t offset, uint32_t size)
+{
+	uint8_t *dest = buffer;
+	uint32_t done = 0;
+
+	if (!FLASH_CACHE_BLOCKS || size > FLASH_CACHE_MAX_READ)
+		return flash_read_uncached(buffer, offset, size);
+
+	while (done < size) {
+		uint32_t pos = offset + done;
+		uint32_t start = ALIGN_DOWN(pos, FLASH_CACHE_BLOCK_SIZE);
+		uint32_t len = MIN(start + FLASH_CACHE_BLOCK_SIZE - pos,
+				   size - done);
+		FlashCacheBlock *block = flash_cache_get(start);
+
+		if (!block) {
+			/*
+			 * The block runs past the end of the flash or
+			 * couldn't be read, so let the driver sort out the
+			 * rest.
+			 */
+			int ret = flash_read_uncached(dest + done, pos,
+						      size - done);
+			if (ret < 0)
+				return ret;
+			return done + ret;
+		}
+
+		memcpy(dest + done, block->data + pos - start, len);
+		done += len;
+	}
+
+	return size;
 }
 
 int __must_check flash_read(void *buffer, uint32_t offset, uint32_t size)
 {
-	return flash_read_ops(flash_ops, buffer, offset, size);
+	uint64_t start = timer_us(0);
+	int ret = flash_cache_read(buffer, offset, size);
+
+	flash_bytes_requested += size;
+	flash_read_us += timer_us(start);
+	return ret;
+}
+
+int __must_check flash_read_direct(void *buffer, uint32_t offset,
+				   uint32_t size)
+{
+	uint64_t start = timer_us(0);
+	int ret = flash_read_uncached(buffer, offset, size);
+
+	flash_bytes_requested += size;
+	flash_read_us += timer_us(start);
+	return ret;
 }
 
 int __must_check flash_write(const void *buffer, uint32_t offset, uint32_t size)
@@ -60,11 +60,20 @@ typedef struct FlashOps
 	uint32_t sector_size;
 	/* Total number of sectors present */
 	uint32_t sector_count;
+	/*
+	 * Set if bits can be cleared by writing without an erase first, and
+	 * any part of an erased sector can be written, as on SPI NOR flash.
+	 * Rewrites then only program the bytes which changed.
+	 */
+	int program_without_erase;
 } FlashOps;
 
 /* Functions operating on flash_ops */
 void flash_set_ops(FlashOps *ops);
 int __must_check flash_read(void *buffer, uint32_t offset, uint32_t size);
+/* Like flash_read(), but neither uses nor fills the read cache. */
+int __must_check flash_read_direct(void *buffer, uint32_t offset,
+				   uint32_t size);
 int __must_check flash_write(const void *buffer, uint32_t offset,
 			     uint32_t size);
 int __must_check flash_erase(uint32_t offset, uint32_t size);
@@ -86,6 +95,12 @@ int __must_check flash_erase_ops(FlashOps *ops, uint32_t offset, uint32_t size);
 int __must_check flash_rewrite_ops(FlashOps *ops, const void *buffer,
 				   uint32_t start, uint32_t length);
 
+/*
+ * Copy size bytes out of a memory mapped flash window at src, using the
+ * widest aligned loads available.
+ */
+void flash_mmio_copy(void *dest, const void *src, uint32_t size);
+
 /* List of supported flashes terminated with a 0 filled element*/
 extern FlashProtectionMapping flash_protection_list[];
 
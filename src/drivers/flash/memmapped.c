@@ -43,8 +43,9 @@ static int mmap_flash_read(void *buffer, uint32_t offset, uint32_t size,
 {
 	/* Convert offset within flash space into an offset within host space */
 	uint32_t rel_offset = offset - window->flash_base;
-	memcpy(buffer, (void *)(uintptr_t)(window->host_base + rel_offset),
-	       size);
+	flash_mmio_copy(buffer,
+			(void *)(uintptr_t)(window->host_base + rel_offset),
+			size);
 	return size;
 }
 
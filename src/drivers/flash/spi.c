@@ -25,34 +25,47 @@
 
 typedef enum {
 	ReadCommand = 3,
+	FastReadCommand = 0xb,
+	ReadSfdpCommand = 0x5a,
 	ReadSr1Command = 5,
 	WriteStatus = 1,
 	WriteCommand = 2,
 	WriteEnableCommand = 6,
+	SectorErase4kCommand = 0x20,
+	BlockErase64kCommand = 0xd8,
 	ReadId = 0x9f
 } SpiFlashCommands;
 
-static int spi_flash_read(FlashOps *me, void *buffer, uint32_t offset,
-			  uint32_t size)
-{
-	SpiFlash *flash = container_of(me, SpiFlash, ops);
+static const SpiFlashReadMode LegacyRead = {
+	.cmd = ReadCommand, .dummy_bytes = 0, .width = 1, .name = "read",
+};
 
-	assert(offset + size <= flash->rom_size);
+static int spi_flash_read_with(SpiFlash *flash, const SpiFlashReadMode *mode,
+			       void *buffer, uint32_t offset, uint32_t size)
+{
+	uint8_t command[4 + 4] = {
+		mode->cmd, offset >> 16, offset >> 8, offset,
+	};
+	int ret;
 
 	if (flash->spi->start(flash->spi)) {
 		printf("%s: Failed to start flash transaction.\n", __func__);
 		return -1;
 	}
 
-	uint32_t command = htobe32((ReadCommand << 24) | offset);
-
-	if (flash->spi->transfer(flash->spi, NULL, &command, sizeof(command))) {
+	if (flash->spi->transfer(flash->spi, NULL, command,
+				 4 + mode->dummy_bytes)) {
 		printf("%s: Failed to send read command.\n", __func__);
 		flash->spi->stop(flash->spi);
 		return -1;
 	}
 
-	if (flash->spi->transfer(flash->spi, buffer, NULL, size)) {
+	if (mode->width > 1)
+		ret = flash->spi->receive_wide(flash->spi, buffer, size,
+					       mode->width);
+	else
+		ret = flash->spi->transfer(flash->spi, buffer, NULL, size);
+	if (ret) {
 		printf("%s: Failed to receive %u bytes.\n", __func__, size);
 		flash->spi->stop(flash->spi);
 		return -1;
@@ -66,6 +79,131 @@ static int spi_flash_read(FlashOps *me, void *buffer, uint32_t offset,
 	return size;
 }
 
+#define SFDP_SIGNATURE 0x50444653 /* "SFDP" */
+#define SFDP_BFPT_DWORDS 4
+/* Basic Flash Parameter Table, first DWORD. */
+#define SFDP_BFPT_FAST_READ_112 (1 << 16)
+#define SFDP_BFPT_FAST_READ_114 (1 << 22)
+#define SFDP_VERIFY_SIZE 256
+
+/*
+ * Fill in mode from the opcode and wait state fields of a BFPT DWORD.
+ * The address goes out on one line, so the dummy clocks need to make up
+ * whole bytes.
+ */
+static int sfdp_read_mode(SpiFlashReadMode *mode, uint16_t field,
+			  uint8_t width, const char *name)
+{
+	uint8_t clocks = (field & 0x1f) + ((field >> 5) & 0x7);
+
+	if (!(field >> 8) || clocks % 8 || clocks / 8 > 4)
+		return -1;
+
+	mode->cmd = field >> 8;
+	mode->dummy_bytes = clocks / 8;
+	mode->width = width;
+	mode->name = name;
+	return 0;
+}
+
+/* Check that a read mode returns the same data as a plain read. */
+static int spi_flash_verify_read_mode(SpiFlash *flash,
+				      const SpiFlashReadMode *mode,
+				      const uint8_t *expected)
+{
+	uint8_t data[SFDP_VERIFY_SIZE];
+
+	if (spi_flash_read_with(flash, mode, data, 0, sizeof(data)) !=
+	    sizeof(data))
+		return -1;
+	return memcmp(data, expected, sizeof(data)) ? -1 : 0;
+}
+
+/*
+ * Pick the fastest read command the flash (according to its SFDP tables)
+ * and the SPI controller both support. Anything that doesn't return the
+ * same data as the legacy read command is skipped, e.g. quad reads with
+ * the flash's QE bit clear.
+ */
+static void spi_flash_probe_read_mode(SpiFlash *flash)
+{
+	const SpiFlashReadMode sfdp = {
+		.cmd = ReadSfdpCommand, .dummy_bytes = 1, .width = 1,
+	};
+	SpiFlashReadMode modes[3];
+	int count = 0;
+	uint32_t header[2], param[2], bfpt[SFDP_BFPT_DWORDS] = { 0 };
+	uint8_t expected[SFDP_VERIFY_SIZE];
+	unsigned int max_width = flash->spi->receive_wide ?
+				 flash->spi->max_rx_width : 1;
+
+	flash->read_mode = LegacyRead;
+	flash->read_mode_probed = 1;
+
+	if (spi_flash_read_with(flash, &sfdp, header, 0, sizeof(header)) !=
+	    sizeof(header) || le32toh(header[0]) != SFDP_SIGNATURE)
+		return;
+
+	/* The first parameter header is always the BFPT. */
+	if (spi_flash_read_with(flash, &sfdp, param, sizeof(header),
+				sizeof(param)) != sizeof(param))
+		return;
+	uint32_t bfpt_dwords = MIN(le32toh(param[0]) >> 24, SFDP_BFPT_DWORDS);
+	uint32_t bfpt_offset = le32toh(param[1]) & 0xffffff;
+	if (spi_flash_read_with(flash, &sfdp, bfpt, bfpt_offset,
+				bfpt_dwords * sizeof(uint32_t)) !=
+	    bfpt_dwords * sizeof(uint32_t))
+		return;
+	for (int i = 0; i < SFDP_BFPT_DWORDS; i++)
+		bfpt[i] = le32toh(bfpt[i]);
+
+	if (max_width >= 4 && (bfpt[0] & SFDP_BFPT_FAST_READ_114) &&
+	    !sfdp_read_mode(&modes[count], bfpt[2] >> 16, 4, "quad read"))
+		count++;
+	if (max_width >= 2 && (bfpt[0] & SFDP_BFPT_FAST_READ_112) &&
+	    !sfdp_read_mode(&modes[count], bfpt[3], 2, "dual read"))
+		count++;
+	/* Anything new enough to have SFDP has fast read. */
+	modes[count++] = (SpiFlashReadMode){
+		.cmd = FastReadCommand, .dummy_bytes = 1, .width = 1,
+		.name = "fast read",
+	};
+
+	if (spi_flash_read_with(flash, &LegacyRead, expected, 0,
+				sizeof(expected)) != sizeof(expected))
+		return;
+
+	/* A blank flash can't tell working and broken modes apart. */
+	int varied = 0;
+	for (int i = 1; i < sizeof(expected); i++)
+		varied |= expected[i] != expected[0];
+	if (!varied)
+		return;
+
+	for (int i = 0; i < count; i++) {
+		if (spi_flash_verify_read_mode(flash, &modes[i], expected))
+			continue;
+		flash->read_mode = modes[i];
+		printf("SPI flash: using %s (%#x).\n", modes[i].name,
+		       modes[i].cmd);
+		return;
+	}
+}
+
+static int spi_flash_read(FlashOps *me, void *buffer, uint32_t offset,
+			  uint32_t size)
+{
+	SpiFlash *flash = container_of(me, SpiFlash, ops);
+
+	assert(offset + size <= flash->rom_size);
+
+	if (!flash->read_mode_probed)
+		spi_flash_probe_read_mode(flash);
+
+	return spi_flash_read_with(flash, &flash->read_mode, buffer, offset,
+				   size);
+}
+
 /* Generate a 10 us 'CS inactive' pulse. */
 static int toggle_cs(SpiFlash *flash, const char *phase)
 {
@@ -285,10 +423,23 @@ static int spi_flash_erase(FlashOps *me, uint32_t start, uint32_t size)
 	}
 	assert(start + size <= flash->rom_size);
 	int offset;
-	for (offset = 0; offset < size; offset += sector_size) {
+	for (offset = 0; offset < size; ) {
+		uint32_t erase_size = sector_size;
+		uint8_t erase_cmd = flash->erase_cmd;
+
+		/* Use block erases where a whole 64K block is covered. */
+		if (erase_cmd == SectorErase4kCommand &&
+		    sector_size == 4 * KiB &&
+		    IS_ALIGNED(start + offset, 64 * KiB) &&
+		    size - offset >= 64 * KiB) {
+			erase_size = 64 * KiB;
+			erase_cmd = BlockErase64kCommand;
+		}
+
 		if (spi_flash_modify(flash, NULL, start + offset, 0,
-				     flash->erase_cmd, "erase"))
+				     erase_cmd, "erase"))
 			break;
+		offset += erase_size;
 	}
 	return offset;
 }
@@ -423,6 +574,7 @@ SpiFlash *new_spi_flash(SpiOps *spi)
 	flash->ops.sector_size = sector_size;
 	assert(rom_size == ALIGN_DOWN(rom_size, sector_size));
 	flash->ops.sector_count = rom_size / sector_size;
+	flash->ops.program_without_erase = 1;
 	flash->spi = spi;
 	flash->rom_size = rom_size;
 	flash->erase_cmd = erase_cmd;
@@ -25,12 +25,25 @@
 struct SpiOps;
 typedef struct SpiOps SpiOps;
 
+typedef struct
+{
+	/* Opcode, followed by a 3 byte address and dummy_bytes of zeroes. */
+	uint8_t cmd;
+	uint8_t dummy_bytes;
+	/* How many lines the data comes back on. */
+	uint8_t width;
+	const char *name;
+} SpiFlashReadMode;
+
 typedef struct
 {
 	FlashOps ops;
 	SpiOps *spi;
 	uint32_t rom_size;
 	uint8_t erase_cmd;
+	/* Picked from what SFDP says the flash supports on the first read. */
+	SpiFlashReadMode read_mode;
+	int read_mode_probed;
 } SpiFlash;
 
 SpiFlash *new_spi_flash(SpiOps *spi);
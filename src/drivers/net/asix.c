@@ -236,51 +236,77 @@ static int asix_send(NetDevice *net_dev, void *buf, uint16_t len)
 	return 0;
 }
 
-static int asix_recv(NetDevice *net_dev, void *buf, uint16_t *len, int maxlen)
+/*
+ * Queue the complete frames from the last bulk transfer which haven't been
+ * queued yet, or from a new transfer if there are none left.
+ */
+static int asix_fill_rx_queue(NetDevice *net_dev, NetRxQueue *queue)
 {
 	GenericUsbDevice *gen_dev = (GenericUsbDevice *)net_dev->dev_data;
 	usbdev_t *usb_dev = gen_dev->dev;
 
-	uint32_t packet_len;
-	static int32_t buf_size = 0;
-	static uint8_t msg[RxUrbSize + sizeof(packet_len)];
+	uint32_t header;
+	static uint8_t msg[RxUrbSize + sizeof(header)];
+	/* Frames left over when the queue filled up last time. */
+	static int32_t buf_size;
 	static int offset;
 
-	if (offset >= buf_size) {
+	net_rx_queue_reset(queue);
+
+	if (offset + sizeof(header) > buf_size) {
 		offset = 0;
 		buf_size = usb_dev->controller->bulk(asix_dev.bulk_in,
 				RxUrbSize, msg, 0);
-		if (buf_size < 0)
+		if (buf_size < 0) {
+			buf_size = 0;
 			return 1;
+		}
 	}
 
-	if (!buf_size) {
-		*len = 0;
-		return 0;
+	while (offset + sizeof(header) <= buf_size &&
+	       !net_rx_queue_full(queue)) {
+		memcpy(&header, msg + offset, sizeof(header));
+
+		uint16_t len = header & 0x7ff;
+		uint32_t packet_len = (~header >> 16) & 0x7ff;
+		if (len != packet_len) {
+			buf_size = 0;
+			printf("ASIX: Malformed packet length.\n");
+			return 1;
+		}
+		if (packet_len & 1)
+			packet_len++;
+		if (offset + sizeof(header) + packet_len > buf_size) {
+			buf_size = 0;
+			printf("ASIX: Packet is too large.\n");
+			return 1;
+		}
+
+		int frame_offset = offset + sizeof(header);
+		offset += sizeof(header) + packet_len;
+
+		/*
+		 * uIP may scribble over everything up to the next frame, or
+		 * to the end of the buffer if this was the last one.
+		 */
+		net_rx_queue_push(queue, msg + frame_offset, len,
+				  (offset < buf_size ? offset : sizeof(msg)) -
+				  frame_offset);
 	}
 
-	memcpy(&packet_len, msg + offset, sizeof(packet_len));
+	return 0;
+}
 
-	*len = (packet_len & 0x7ff);
-	packet_len = (~packet_len >> 16) & 0x7ff;
-	if (*len != packet_len) {
-		buf_size = 0;
-		offset = 0;
-		printf("ASIX: Malformed packet length.\n");
-		return 1;
-	}
-	if (packet_len & 1)
-		packet_len++;
-	if (packet_len > maxlen || offset + packet_len > buf_size) {
-		buf_size = 0;
-		offset = 0;
-		printf("ASIX: Packet is too large.\n");
-		return 1;
-	}
+static int asix_recv_frame(NetDevice *net_dev, uint8_t **frame,
+			   uint16_t *len, uint16_t *room)
+{
+	NetRxQueue *queue = &net_dev->rx_queue;
 
-	memcpy(buf, msg + offset + sizeof(packet_len), packet_len);
-	offset += sizeof(packet_len) + packet_len;
+	*len = 0;
+	if (net_rx_queue_empty(queue) && asix_fill_rx_queue(net_dev, queue))
+		return 1;
 
+	net_rx_queue_pop(queue, frame, len, room);
 	return 0;
 }
 
@@ -320,7 +346,7 @@ static AsixDev asix_dev = {
 		.init = &asix_init,
 		.net_dev = {
 			.ready = &mii_ready,
-			.recv = &asix_recv,
+			.recv_frame = &asix_recv_frame,
 			.send = &asix_send,
 			.get_mac = &asix_get_mac,
 			.mdio_read = &asix_mdio_read,
@@ -41,7 +41,7 @@ void net_add_device(NetDevice *dev)
 
 	if (dev) {
 		assert(dev->ready);
-		assert(dev->recv);
+		assert(dev->recv || dev->recv_frame);
 		assert(dev->send);
 		assert(dev->get_mac);
 	}
@@ -95,19 +95,46 @@ void net_wait_for_link(void)
 	}
 }
 
-void net_poll(void)
+// Whether frames from the device's last transfer are still queued.
+static int net_rx_pending(void)
 {
-	if (!net_device) {
-		printf("No network device.\n");
-		return;
+	return net_device->recv_frame &&
+	       !net_rx_queue_empty(&net_device->rx_queue);
+}
+
+// Receive the next frame into uip_buf. If the driver supports it and
+// there's room for uIP to build its reply in place, uip_buf is pointed
+// straight at the frame in the driver's buffer instead of copying it.
+static int net_recv(void)
+{
+	if (!net_device->recv_frame)
+		return net_device->recv(net_device, uip_buf, &uip_len,
+					CONFIG_UIP_BUFSIZE);
+
+	uint8_t *frame;
+	uint16_t len, room;
+	if (net_device->recv_frame(net_device, &frame, &len, &room))
+		return 1;
+
+	uip_len = 0;
+	if (!len)
+		return 0;
+	if (len > CONFIG_UIP_BUFSIZE) {
+		printf("Dropping oversized frame (%u bytes).\n", len);
+		return 0;
 	}
 
+	if (room >= CONFIG_UIP_BUFSIZE)
+		uip_buf = frame;
+	else
+		memcpy(uip_buf, frame, len);
+	uip_len = len;
+	return 0;
+}
+
+static void net_process(void)
+{
 	struct uip_eth_hdr *hdr = (struct uip_eth_hdr *)uip_buf;
-	if (net_device->recv(net_device, uip_buf, &uip_len,
-			     CONFIG_UIP_BUFSIZE)) {
-		printf("Receive failed.\n");
-		return;
-	}
 	if (uip_len) {
 		if (hdr->type == htonw(UIP_ETHTYPE_IP)) {
 			uip_arp_ipin();
@@ -122,6 +149,49 @@ void net_poll(void)
 				net_device->send(net_device, uip_buf, uip_len);
 		}
 	}
+
+	// Anything sent outside of net_poll() is built in uIP's own buffer.
+	uip_buf = uip_aligned_buf.u8;
+}
+
+void net_poll(void)
+{
+	if (!net_device) {
+		printf("No network device.\n");
+		return;
+	}
+
+	if (net_recv()) {
+		printf("Receive failed.\n");
+		return;
+	}
+	net_process();
+}
+
+// Like net_poll(), but keeps going until every frame from the device's last
+// aggregated transfer has been handled, and acknowledges TCP data once for
+// the whole batch rather than once per segment.
+void net_poll_all(void)
+{
+	uip_ack_coalesce = 1;
+	do {
+		net_poll();
+	} while (net_device && net_rx_pending());
+	uip_ack_coalesce = 0;
+
+	if (!net_device)
+		return;
+
+	// Send the ACKs which were held back while draining the queue.
+	for (int i = 0; i < CONFIG_UIP_CONNS; i++) {
+		if (!uip_conns[i].ack_pending)
+			continue;
+		uip_ack_conn(&uip_conns[i]);
+		if (uip_len > 0) {
+			uip_arp_out();
+			net_device->send(net_device, uip_buf, uip_len);
+		}
+	}
 }
 
 int net_send(void *buf, uint16_t len)
@@ -23,16 +23,43 @@
 
 #include "net/uip.h"
 
+typedef struct NetRxFrame {
+	uint8_t *data;
+	uint16_t len;
+	// How many bytes from data may be overwritten without clobbering
+	// any other queued frame.
+	uint16_t room;
+} NetRxFrame;
+
+#define NET_RX_QUEUE_SIZE 64
+
+typedef struct NetRxQueue {
+	NetRxFrame frames[NET_RX_QUEUE_SIZE];
+	int count;
+	int next;
+} NetRxQueue;
+
 typedef struct NetDevice {
 	struct list_node list_node;
 	int (*ready)(struct NetDevice *dev, int *ready);
 	int (*recv)(struct NetDevice *dev, void *buf, uint16_t *len,
 		int maxlen);
+	/*
+	 * Optional zero-copy receive. Points frame at the next received
+	 * frame inside the driver's own buffer and sets room to how many
+	 * bytes from there may be overwritten without clobbering frames
+	 * that haven't been returned yet. len is 0 if nothing arrived.
+	 * Drivers which get several frames per transfer queue them in
+	 * rx_queue and only start a new transfer once it is empty.
+	 */
+	int (*recv_frame)(struct NetDevice *dev, uint8_t **frame,
+		uint16_t *len, uint16_t *room);
 	int (*send)(struct NetDevice *dev, void *buf, uint16_t len);
 	int (*mdio_read)(struct NetDevice *dev, uint8_t loc, uint16_t *val);
 	int (*mdio_write)(struct NetDevice *dev, uint8_t loc, uint16_t val);
 	const uip_eth_addr *(*get_mac)(struct NetDevice *dev);
 	void *dev_data;
+	NetRxQueue rx_queue;
 } NetDevice;
 
 typedef struct NetPoller {
@@ -44,10 +71,51 @@ void net_add_device(NetDevice *dev);
 void net_remove_device(NetDevice *dev);
 NetDevice *net_get_device(void);
 void net_poll(void);
+void net_poll_all(void);
 int net_send(void *buf, uint16_t len);
 void net_wait_for_link(void);
 const uip_eth_addr *net_get_mac(void);
 
+static inline void net_rx_queue_push(NetRxQueue *queue, uint8_t *data,
+				     uint16_t len, uint16_t room)
+{
+	NetRxFrame *frame = &queue->frames[queue->count++];
+
+	frame->data = data;
+	frame->len = len;
+	frame->room = room;
+}
+
+static inline int net_rx_queue_full(NetRxQueue *queue)
+{
+	return queue->count == NET_RX_QUEUE_SIZE;
+}
+
+static inline int net_rx_queue_empty(NetRxQueue *queue)
+{
+	return queue->next == queue->count;
+}
+
+static inline void net_rx_queue_reset(NetRxQueue *queue)
+{
+	queue->count = queue->next = 0;
+}
+
+// Take the next frame off the queue, or set len to 0 if it's empty.
+static inline void net_rx_queue_pop(NetRxQueue *queue, uint8_t **data,
+				    uint16_t *len, uint16_t *room)
+{
+	if (net_rx_queue_empty(queue)) {
+		*len = 0;
+		return;
+	}
+
+	NetRxFrame *frame = &queue->frames[queue->next++];
+	*data = frame->data;
+	*len = frame->len;
+	*room = frame->room;
+}
+
 extern struct list_node net_pollers;
 
 #endif /* __DRIVERS_NET_NET_H__ */
@@ -1006,61 +1006,92 @@ static int rtl8152_send(NetDevice *net_dev, void *buf, uint16_t len)
 		< 0);
 }
 
-static int rtl8152_recv(NetDevice *net_dev, void *buf, uint16_t *len,
-			int maxlen)
+/* Queue every complete frame from the next bulk transfer. */
+static int rtl8152_fill_rx_queue(NetDevice *net_dev, NetRxQueue *queue)
 {
 	GenericUsbDevice *gen_dev = (GenericUsbDevice *)net_dev->dev_data;
 	usbdev_t *usb_dev = gen_dev->dev;
 
 	uint32_t rx_desc[6];
 	int32_t packet_len;
-	static int32_t buf_size = 0;
 	static uint8_t msg[ETHERNET_MAX_FRAME_SIZE + sizeof(rx_desc)];
-	static int32_t offset, partial;
+	/* Incomplete data left at the end of the previous transfer. */
+	static int32_t leftover_offset, leftover_size;
 	static uint64_t last_poll = 0;
 
 	/* Wait at least 20 us between polling for receive. */
 	while (timer_us(last_poll) < 20);
 	last_poll = timer_us(0);
 
-	if (partial || offset >= buf_size) {
-		offset = 0;
-		buf_size = usb_dev->controller->bulk(r8152_dev.bulk_in,
-				sizeof(msg) - partial, msg + partial, 0);
-		if (buf_size < 0) {
-			printf("R8152: Bulk read error %#x\n", buf_size);
-			return 1;
-		}
-		buf_size += partial;
-		partial = 0;
+	/*
+	 * The frames queued last time have been consumed by now, so it's
+	 * safe to move any leftover data to the front of the buffer and
+	 * append the next transfer to it.
+	 */
+	int32_t carry = leftover_size;
+	if (carry)
+		memmove(msg, msg + leftover_offset, carry);
+	leftover_offset = leftover_size = 0;
+	net_rx_queue_reset(queue);
+
+	int32_t buf_size = usb_dev->controller->bulk(r8152_dev.bulk_in,
+			sizeof(msg) - carry, msg + carry, 0);
+	if (buf_size < 0) {
+		printf("R8152: Bulk read error %#x\n", buf_size);
+		return 1;
 	}
+	buf_size += carry;
 
-	*len = 0;
-	if (buf_size < offset + sizeof(rx_desc))
-		return 0;
+	int32_t offset = 0;
+	while (buf_size >= offset + sizeof(rx_desc)) {
+		memcpy(&rx_desc, msg + offset, sizeof(rx_desc));
+		packet_len = le32toh(rx_desc[0]) & 0x7fff;
+		packet_len -= 4;
 
-	memcpy(&rx_desc, msg + offset, sizeof(rx_desc));
-	packet_len = le32toh(rx_desc[0]) & 0x7fff;
-	packet_len -= 4;
+		if (packet_len < 0 ||
+		    sizeof(rx_desc) + packet_len + 4 > sizeof(msg)) {
+			printf("R8152: Packet is too large.\n");
+			return 1;
+		}
 
-	if (packet_len > maxlen ||
-	    offset + sizeof(rx_desc) + packet_len > sizeof(msg)) {
-		buf_size = 0;
-		offset = 0;
-		printf("R8152: Packet is too large.\n");
-		return 1;
+		/* The rest of this frame is in the next transfer. */
+		if (offset + sizeof(rx_desc) + packet_len > buf_size ||
+		    net_rx_queue_full(queue))
+			break;
+
+		int32_t frame_offset = offset + sizeof(rx_desc);
+		offset += sizeof(rx_desc) + packet_len + 4;
+		offset = ALIGN_UP(offset, 8);
+
+		/*
+		 * uIP may scribble over everything up to the next frame, or
+		 * to the end of the buffer if this was the last one.
+		 */
+		int32_t room = (offset < buf_size ? offset : sizeof(msg)) -
+			       frame_offset;
+		net_rx_queue_push(queue, msg + frame_offset, packet_len,
+				  MIN(room, UINT16_MAX));
 	}
 
-	if  (offset == 0 && packet_len > buf_size) {
-		partial = buf_size;
-		return 0;
+	if (offset < buf_size) {
+		leftover_offset = offset;
+		leftover_size = buf_size - offset;
 	}
 
-	*len = packet_len;
-	memcpy(buf, msg + offset + sizeof(rx_desc), packet_len);
-	offset += sizeof(rx_desc) + packet_len + 4;
-	offset = ALIGN_UP(offset, 8);
+	return 0;
+}
+
+static int rtl8152_recv_frame(NetDevice *net_dev, uint8_t **frame,
+			      uint16_t *len, uint16_t *room)
+{
+	NetRxQueue *queue = &net_dev->rx_queue;
+
+	*len = 0;
+	if (net_rx_queue_empty(queue) &&
+	    rtl8152_fill_rx_queue(net_dev, queue))
+		return 1;
 
+	net_rx_queue_pop(queue, frame, len, room);
 	return 0;
 }
 
@@ -1119,7 +1150,7 @@ static R8152Dev r8152_dev = {
 		.init = &rtl8152_init,
 		.net_dev = {
 			.ready = &mii_ready,
-			.recv = &rtl8152_recv,
+			.recv_frame = &rtl8152_recv_frame,
 			.send = &rtl8152_send,
 			.get_mac = &rtl8152_get_mac,
 			.mdio_read = &rtl8152_mdio_read,
@@ -63,6 +63,8 @@ typedef struct BlockDev {
 	int removable;
 	int external_gpt;
 	unsigned block_size;
+	/* Blocks read back as zeroes after a successful ops.erase. */
+	int erase_zeroes;
 	/* If external_gpt = 0, then stream_block_count may be 0, indicating
 	 * that the block_count value applies for both read/write and streams */
 	lba_t block_count;		/* size addressable by read/write */
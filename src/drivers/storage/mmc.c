@@ -1201,6 +1201,10 @@ static int mmc_startup(MmcMedia *media)
 
 			media->supported_driver_strengths =
 				ext_csd[EXT_CSD_DRIVER_STRENGTH];
+
+			/* Trimmed blocks read back as the erased value. */
+			media->dev.erase_zeroes =
+				!ext_csd[EXT_CSD_ERASED_MEM_CONT];
 		}
 	}
 
@@ -109,6 +109,24 @@ static struct tpm2_info tpm_info;
  */
 static const int debug_level_ = 0;
 
+/*
+ * GSC stays awake for a second after any SPI activity, so the wake pulse is
+ * only needed when it's been quieter than that, with some margin.
+ */
+#define TPM_WAKE_WINDOW_US (900 * USECS_PER_MSEC)
+
+/* When the last transaction started, 0 if there hasn't been one. */
+static uint64_t last_transaction_us;
+
+/*
+ * Burst count from the last read of the status register. It is refreshed
+ * at every step of a command where the status register has to be read
+ * anyway, and FIFO transfers use it rather than reading the status register
+ * again before every chunk. SPI flow control stalls any chunk the TPM isn't
+ * ready for yet. Zero means it has to be read before the next transfer.
+ */
+static uint32_t cached_burst_count;
+
 /*
  * SPI frame header for TPM transactions is 4 bytes in size, it is described
  * in section "6.4.6 Spi Bit Protocol".
@@ -169,11 +187,15 @@ static int start_transaction(int read_write, size_t bytes, unsigned addr)
 	/* Wait for tpm to finish previous transaction */
 	tpm_sync();
 
-	/* Try to wake gsc if it is asleep. */
-	tpm_if.cs_assert(tpm_if.peripheral);
-	udelay(1);
-	tpm_if.cs_deassert(tpm_if.peripheral);
-	udelay(100);
+	/* Try to wake gsc if it could have gone to sleep. */
+	if (!last_transaction_us ||
+	    timer_us(last_transaction_us) > TPM_WAKE_WINDOW_US) {
+		tpm_if.cs_assert(tpm_if.peripheral);
+		udelay(1);
+		tpm_if.cs_deassert(tpm_if.peripheral);
+		udelay(100);
+	}
+	last_transaction_us = timer_us(0);
 
 	/*
 	 * The first byte of the frame header encodes the transaction type
@@ -350,7 +372,14 @@ static int tpm2_read_reg(unsigned reg_number, void *buffer, size_t bytes)
  */
 static int read_tpm_sts(uint32_t *status)
 {
-	return tpm2_read_reg(TPM_STS_REG, status, sizeof(*status));
+	int result = tpm2_read_reg(TPM_STS_REG, status, sizeof(*status));
+
+	if (result)
+		cached_burst_count = 0;
+	else
+		cached_burst_count = (*status & TpmStsBurstCountMask) >>
+				     TpmStsBurstCountShift;
+	return result;
 }
 
 static int write_tpm_sts(uint32_t status)
@@ -368,7 +397,7 @@ static uint32_t get_burst_count(void)
 	uint32_t status;
 
 	read_tpm_sts(&status);
-	return (status & TpmStsBurstCountMask) >> TpmStsBurstCountShift;
+	return cached_burst_count;
 }
 
 static uint8_t tpm2_read_access_reg(void)
@@ -496,29 +525,30 @@ union fifo_transfer_buffer {
 };
 
 /*
- * Transfer requested number of bytes to or from TPM FIFO, accounting for the
- * current burst count value.
+ * Transfer requested number of bytes to or from TPM FIFO, in chunks as large
+ * as the burst count allows. The status register is only read if there's no
+ * burst count from earlier in the command to go by.
  */
 static void fifo_transfer(size_t transfer_size,
 			  union fifo_transfer_buffer buffer,
 			  enum fifo_transfer_direction direction)
 {
 	size_t transaction_size;
-	size_t burst_count;
+	size_t burst_count = cached_burst_count;
 	size_t handled_so_far = 0;
 
 	do {
 		struct stopwatch sw;
 		stopwatch_init_msecs_expire(&sw, 100);
 
-		do {
+		while (!burst_count) {
 			/* Could be zero when TPM is busy. */
 			burst_count = get_burst_count();
 			if (stopwatch_expired(&sw)) {
 				printf("exceeded tpm wait in burst loop\n");
 				return;
 			}
-		} while (!burst_count);
+		}
 
 		transaction_size = transfer_size - handled_so_far;
 		transaction_size = MIN(transaction_size, burst_count);
@@ -579,6 +609,9 @@ static size_t tpm2_process_command(const void *tpm2_command,
 		return 0;
 	}
 
+	/* Burst counts from the previous command don't apply any more. */
+	cached_burst_count = 0;
+
 	/*
 	 * Tpm commands and responses written to and read from the FIFO
 	 * register (0x24) are datagrams of variable size, prepended by a 6
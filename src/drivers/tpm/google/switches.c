@@ -21,7 +21,6 @@ struct tpm_get_btn_msg {
 /**
  * Read a button/switch state from the GSC.
  *
- * @param tpm              Pointer to the TPM operations structure.
  * @param gsc_subcommand   GSC vendor specific sub-command for the
  *                         button/switch. Supported sub-commands are
  *                         VENDOR_CC_GET_REC_BTN and VENDOR_CC_GET_PWR_BTN.
@@ -30,8 +29,7 @@ struct tpm_get_btn_msg {
  *
  * @return 0 on success, non-zero if an error is detected.
  */
-static int gsc_switch_get(struct TpmOps *tpm, uint16_t gsc_subcommand,
-			   int *button_state)
+static int gsc_switch_get(uint16_t gsc_subcommand, int *button_state)
 {
 	struct tpm_vendor_header req;
 	struct tpm_get_btn_msg res;
@@ -44,9 +42,8 @@ static int gsc_switch_get(struct TpmOps *tpm, uint16_t gsc_subcommand,
 
 	tpm_google_fill_vendor_cmd_header(&req, gsc_subcommand, 0);
 
-	xmit_res = tpm->xmit(tpm, (void *)&req,
-			     sizeof(struct tpm_vendor_header),
-			     (void *)&res, &buffer_size);
+	xmit_res = tpm_xmit((void *)&req, sizeof(struct tpm_vendor_header),
+			    (void *)&res, &buffer_size);
 
 	/*
 	 * The response size varies depending on whether the GSC supports
@@ -96,21 +93,19 @@ static int gsc_switch_get(struct TpmOps *tpm, uint16_t gsc_subcommand,
  */
 static int gsc_rec_switch_get(GpioOps *me)
 {
-	TpmOps *tpm = container_of(me, GscSwitch, ops)->tpm;
 	int recovery_button = 0;
 
 	/* Errors are logged by gsc_switch_get() */
-	if (gsc_switch_get(tpm, VENDOR_CC_GET_REC_BTN, &recovery_button))
+	if (gsc_switch_get(VENDOR_CC_GET_REC_BTN, &recovery_button))
 		return -1;
 
 	return recovery_button;
 }
 
-GscSwitch *new_gsc_rec_switch(TpmOps *tpm)
+GscSwitch *new_gsc_rec_switch(void)
 {
 	GscSwitch *rec_switch = xzalloc(sizeof(*rec_switch));
 
-	rec_switch->tpm = tpm;
 	rec_switch->ops.get = gsc_rec_switch_get;
 
 	return rec_switch;
@@ -125,23 +120,19 @@ GscSwitch *new_gsc_rec_switch(TpmOps *tpm)
  */
 static int gsc_power_switch_get(GpioOps *me)
 {
-	struct TpmOps *tpm;
 	int power_button = 0;
 
-	tpm = container_of(me, GscSwitch, ops)->tpm;
-
 	/* Errors are logged by gsc_switch_get() */
-	if (gsc_switch_get(tpm, VENDOR_CC_GET_PWR_BTN, &power_button))
+	if (gsc_switch_get(VENDOR_CC_GET_PWR_BTN, &power_button))
 		return -1;
 
 	return power_button;
 }
 
-GscSwitch *new_gsc_power_switch(TpmOps *tpm)
+GscSwitch *new_gsc_power_switch(void)
 {
 	GscSwitch *power_switch = xzalloc(sizeof(*power_switch));
 
-	power_switch->tpm = tpm;
 	power_switch->ops.get = gsc_power_switch_get;
 
 	return power_switch;
@@ -15,14 +15,90 @@
  * GNU General Public License for more details.
  */
 
+#include <endian.h>
 #include <libpayload.h>
 #include <tss_constants.h>
 
 #include "drivers/tpm/google/tpm.h"
 #include "drivers/tpm/tpm.h"
 
+/* TPM 2.0 values, which tss_constants.h only has in TPM 2.0 builds. */
+enum {
+	Tpm2CcNvRead = 0x14e,
+	Tpm2CcNvReadPublic = 0x169,
+};
+
 static TpmOps *tpm_ops;
 
+/*
+ * Responses to NV reads since the last command which might have changed NV
+ * contents, so reading the same thing twice only goes to the TPM once. Any
+ * command that isn't an NV read empties it, so every command has to be sent
+ * through here rather than straight to tpm_ops.
+ */
+#define TPM_NV_CACHE_ENTRIES 4
+
+static struct {
+	uint8_t cmd[64];
+	size_t cmd_size;
+	uint8_t rsp[256];
+	size_t rsp_size;
+} tpm_nv_cache[TPM_NV_CACHE_ENTRIES];
+static int tpm_nv_cache_next;
+
+static int tpm_nv_cacheable(const uint8_t *sendbuf, size_t send_size)
+{
+	uint32_t ordinal;
+
+	if (!CONFIG(LP_VBOOT_TPM2_MODE) ||
+	    send_size < TpmCmdOrdinalOffset + sizeof(ordinal))
+		return 0;
+
+	ordinal = be32dec(sendbuf + TpmCmdOrdinalOffset);
+	return ordinal == Tpm2CcNvRead || ordinal == Tpm2CcNvReadPublic;
+}
+
+static void tpm_nv_cache_clear(void)
+{
+	for (int i = 0; i < TPM_NV_CACHE_ENTRIES; i++)
+		tpm_nv_cache[i].cmd_size = 0;
+}
+
+static int tpm_nv_cache_lookup(const uint8_t *sendbuf, size_t send_size,
+			       uint8_t *recvbuf, size_t *recv_len)
+{
+	for (int i = 0; i < TPM_NV_CACHE_ENTRIES; i++) {
+		if (tpm_nv_cache[i].cmd_size != send_size ||
+		    memcmp(tpm_nv_cache[i].cmd, sendbuf, send_size) ||
+		    tpm_nv_cache[i].rsp_size > *recv_len)
+			continue;
+
+		memcpy(recvbuf, tpm_nv_cache[i].rsp, tpm_nv_cache[i].rsp_size);
+		*recv_len = tpm_nv_cache[i].rsp_size;
+		return 0;
+	}
+	return -1;
+}
+
+static void tpm_nv_cache_add(const uint8_t *sendbuf, size_t send_size,
+			     const uint8_t *recvbuf, size_t recv_len)
+{
+	int i = tpm_nv_cache_next;
+
+	/* Only keep successful reads that fit. */
+	if (send_size > sizeof(tpm_nv_cache[i].cmd) ||
+	    recv_len > sizeof(tpm_nv_cache[i].rsp) ||
+	    recv_len < TpmRspHeaderSize ||
+	    be32dec(recvbuf + TpmRspCodeOffset) != TPM_SUCCESS)
+		return;
+
+	memcpy(tpm_nv_cache[i].cmd, sendbuf, send_size);
+	tpm_nv_cache[i].cmd_size = send_size;
+	memcpy(tpm_nv_cache[i].rsp, recvbuf, recv_len);
+	tpm_nv_cache[i].rsp_size = recv_len;
+	tpm_nv_cache_next = (i + 1) % TPM_NV_CACHE_ENTRIES;
+}
+
 void tpm_set_ops(TpmOps *ops)
 {
 	die_if(tpm_ops, "%s: TPM ops already set.\n", __func__);
@@ -32,8 +108,20 @@ void tpm_set_ops(TpmOps *ops)
 int tpm_xmit(const uint8_t *sendbuf, size_t send_size,
 	     uint8_t *recvbuf, size_t *recv_len)
 {
+	int cacheable = tpm_nv_cacheable(sendbuf, send_size);
+	int ret;
+
 	die_if(!tpm_ops, "%s: No TPM ops set.\n", __func__);
-	return tpm_ops->xmit(tpm_ops, sendbuf, send_size, recvbuf, recv_len);
+
+	if (!cacheable)
+		tpm_nv_cache_clear();
+	else if (!tpm_nv_cache_lookup(sendbuf, send_size, recvbuf, recv_len))
+		return 0;
+
+	ret = tpm_ops->xmit(tpm_ops, sendbuf, send_size, recvbuf, recv_len);
+	if (cacheable && !ret)
+		tpm_nv_cache_add(sendbuf, send_size, recvbuf, *recv_len);
+	return ret;
 }
 
 char *tpm_report_state(void)
@@ -45,6 +133,7 @@ char *tpm_report_state(void)
 		return NULL;
 	}
 
+	tpm_nv_cache_clear();
 	return tpm_google_get_tpm_state(tpm_ops);
 }
 
@@ -57,5 +146,6 @@ int tpm_set_tpm_mode(uint8_t mode_val)
 		return -1;
 	}
 
+	tpm_nv_cache_clear();
 	return tpm_google_set_tpm_mode(tpm_ops, mode_val);
 }
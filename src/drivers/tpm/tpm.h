@@ -49,6 +49,8 @@ enum {
 enum {
 	TpmCmdCountOffset = 2,
 	TpmCmdOrdinalOffset = 6,
+	TpmRspCodeOffset = 6,
+	TpmRspHeaderSize = 10,
 	TpmMaxBufSize = 1260
 };
 
@@ -65,6 +67,9 @@ void tpm_set_ops(TpmOps *ops);
  *
  * Send the requested data to the TPM and then try to get its response
  *
+ * A repeated TPM 2.0 NV_Read or NV_ReadPublic is answered with the earlier
+ * response, unless another command has been sent in between.
+ *
  * @sendbuf - buffer of the data to send
  * @send_size size of the data to send
  * @recvbuf - memory to save the response to
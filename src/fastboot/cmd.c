@@ -18,6 +18,7 @@
 #include "fastboot/cmd.h"
 #include "fastboot/disk.h"
 #include "fastboot/fastboot.h"
+#include "fastboot/lz4.h"
 #include "fastboot/vars.h"
 #include "gpt_misc.h"
 #include <stdlib.h>
@@ -66,17 +67,28 @@ static void fastboot_cmd_download(fastboot_session_t *fb, const char *arg,
 		return;
 	}
 
-	if (size > FASTBOOT_MAX_DOWNLOAD_SIZE) {
+	// A streamed download only needs to fit on the partition, and a
+	// compressed one only needs to fit once decompressed. Both are
+	// checked as the data arrives.
+	if (size > FASTBOOT_MAX_DOWNLOAD_SIZE && !fb->stream && !fb->lz4) {
 		fastboot_fail(fb, "File too big");
 		return;
 	}
 
+	if (fb->stream)
+		fastboot_stream_begin_download(fb);
+	if (fb->lz4)
+		fastboot_lz4_begin_download(fb);
 	fastboot_data(fb, size);
 }
 
 static void fastboot_cmd_flash(fastboot_session_t *fb, const char *arg,
 			       uint64_t arg_len)
 {
+	// The data may already be on disk.
+	if (fastboot_stream_flash(fb, arg, arg_len))
+		return;
+
 	if (!fb->has_download) {
 		fastboot_fail(fb, "No data staged to flash");
 		return;
@@ -154,6 +166,29 @@ static void fastboot_cmd_oem_get_kernels(fastboot_session_t *fb,
 	fastboot_succeed(fb);
 }
 
+// `fastboot oem stream-flash:<partition>` makes the next download get written
+// to <partition> as it arrives, rather than being buffered in memory until a
+// flash command. The following `fastboot flash <partition>` then just confirms
+// it. This saves a pass over the image and lifts the limit on download size.
+static void fastboot_cmd_oem_stream_flash(fastboot_session_t *fb,
+					  const char *arg, uint64_t arg_len)
+{
+	if (fastboot_stream_start(fb, arg, arg_len))
+		fastboot_succeed(fb);
+}
+
+// `fastboot oem download-lz4` makes the next download get decompressed as it
+// arrives. The data sent has to be in the LZ4 frame format (as written by the
+// lz4 tool), and whatever uses the download sees the decompressed image. This
+// combines with `oem stream-flash`.
+static void fastboot_cmd_oem_download_lz4(fastboot_session_t *fb,
+					  const char *arg, uint64_t arg_len)
+{
+	if (!fb->lz4)
+		fb->lz4 = xzalloc(sizeof(*fb->lz4));
+	fastboot_succeed(fb);
+}
+
 static void fastboot_cmd_reboot(fastboot_session_t *fb, const char *arg,
 				uint64_t arg_len)
 {
@@ -197,7 +232,9 @@ struct fastboot_cmd fastboot_cmds[] = {
 	CMD_ARGS("erase", ':', fastboot_cmd_erase),
 	CMD_ARGS("flash", ':', fastboot_cmd_flash),
 	CMD_ARGS("getvar", ':', fastboot_cmd_getvar),
+	CMD_NO_ARGS("oem download-lz4", fastboot_cmd_oem_download_lz4),
 	CMD_NO_ARGS("oem get-kernels", fastboot_cmd_oem_get_kernels),
+	CMD_ARGS("oem stream-flash", ':', fastboot_cmd_oem_stream_flash),
 	CMD_NO_ARGS("reboot", fastboot_cmd_reboot),
 	CMD_ARGS("set_active", ':', fastboot_cmd_set_active),
 	{
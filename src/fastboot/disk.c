@@ -177,6 +177,97 @@ void fastboot_erase(fastboot_session_t *fb, struct fastboot_disk *disk,
 	fastboot_succeed(fb);
 }
 
+/************************* STREAMING FLASH ******************************/
+
+bool fastboot_stream_start(fastboot_session_t *fb, const char *partition_name,
+			   size_t name_len)
+{
+	fastboot_stream_end(fb);
+
+	struct fastboot_stream *stream = xzalloc(sizeof(*stream));
+	if (!fastboot_disk_init(&stream->disk)) {
+		free(stream);
+		fastboot_fail(fb, "Failed to init disk");
+		return false;
+	}
+
+	stream->partition = fastboot_find_partition(&stream->disk,
+						    partition_name, name_len);
+	if (!stream->partition) {
+		fastboot_disk_destroy(&stream->disk);
+		free(stream);
+		fastboot_fail(fb, "Could not find partition");
+		return false;
+	}
+
+	fb->stream = stream;
+	return true;
+}
+
+void fastboot_stream_begin_download(fastboot_session_t *fb)
+{
+	struct fastboot_stream *stream = fb->stream;
+
+	// The download buffer is only used for staging, so nothing in it
+	// survives a streamed download.
+	stream->done = false;
+	image_writer_init(&stream->writer, &stream->disk, stream->partition,
+			  fastboot_get_download_buffer(fb, NULL),
+			  FASTBOOT_STREAM_STAGE_SIZE);
+}
+
+void fastboot_stream_feed(fastboot_session_t *fb, void *data, size_t len)
+{
+	// Errors are reported once the host has sent everything.
+	image_writer_feed(&fb->stream->writer, data, len);
+}
+
+int fastboot_stream_finish(fastboot_session_t *fb)
+{
+	struct fastboot_stream *stream = fb->stream;
+
+	if (image_writer_finish(&stream->writer)) {
+		fastboot_fail(fb, stream->writer.error);
+		fastboot_stream_end(fb);
+		return -1;
+	}
+
+	stream->done = true;
+	return 0;
+}
+
+bool fastboot_stream_flash(fastboot_session_t *fb, const char *partition_name,
+			   size_t name_len)
+{
+	struct fastboot_stream *stream = fb->stream;
+	if (!stream)
+		return false;
+
+	if (!stream->done) {
+		fastboot_stream_end(fb);
+		return false;
+	}
+
+	bool same = fastboot_find_partition(&stream->disk, partition_name,
+					    name_len) == stream->partition;
+	fastboot_stream_end(fb);
+	// The download is already on the armed partition, it can't be moved.
+	if (same)
+		fastboot_succeed(fb);
+	else
+		fastboot_fail(fb, "Download was streamed to another partition");
+	return true;
+}
+
+void fastboot_stream_end(fastboot_session_t *fb)
+{
+	if (!fb->stream)
+		return;
+	fastboot_disk_destroy(&fb->stream->disk);
+	free(fb->stream);
+	fb->stream = NULL;
+}
+
 /************************* SLOT LOGIC ******************************/
 
 // Returns 0 if the partition is not valid.
@@ -41,6 +41,20 @@ void fastboot_write(fastboot_session_t *fb, struct fastboot_disk *disk,
 		    size_t data_len);
 void fastboot_erase(fastboot_session_t *fb, struct fastboot_disk *disk,
 		    const char *partition_name, size_t name_len);
+
+// Streaming flash: write the next download to a partition as it arrives.
+bool fastboot_stream_start(fastboot_session_t *fb, const char *partition_name,
+			   size_t name_len);
+void fastboot_stream_begin_download(fastboot_session_t *fb);
+void fastboot_stream_feed(fastboot_session_t *fb, void *data, size_t len);
+// Returns 0 if the download was written, or sends a FAIL and returns -1.
+int fastboot_stream_finish(fastboot_session_t *fb);
+// Returns true if a streamed download has been written, and sends OKAY if it
+// went to the named partition or FAIL if it went elsewhere. Returns false if
+// nothing was streamed and the flash should use the download buffer.
+bool fastboot_stream_flash(fastboot_session_t *fb, const char *partition_name,
+			   size_t name_len);
+void fastboot_stream_end(fastboot_session_t *fb);
 int fastboot_get_slot_count(struct fastboot_disk *disk);
 char get_slot_for_partition_name(GptEntry *e, char *partition_name);
 GptEntry *fastboot_get_kernel_for_slot(struct fastboot_disk *disk, char slot);
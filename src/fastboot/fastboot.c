@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include "die.h"
 #include "fastboot/cmd.h"
+#include "fastboot/disk.h"
+#include "fastboot/lz4.h"
 #include "fastboot/tcp.h"
 #include "image/symbols.h"
 #include "stdarg.h"
@@ -77,6 +79,54 @@ void *fastboot_get_download_buffer(fastboot_session_t *fb, uint64_t *len)
 	return &_kernel_start;
 }
 
+/***************************** LZ4 DOWNLOADS ********************************/
+
+// Decompressed data waiting to be streamed to disk is kept after the staging
+// area, with room for a stage's worth beyond the history LZ4 needs.
+#define FASTBOOT_LZ4_WINDOW_SIZE (FASTBOOT_STREAM_STAGE_SIZE + LZ4_HISTORY_SIZE)
+
+static int fastboot_lz4_flush(void *ctx, const void *data, uint64_t len)
+{
+	// Errors are reported once the host has sent everything.
+	fastboot_stream_feed(ctx, (void *)data, len);
+	return 0;
+}
+
+void fastboot_lz4_begin_download(fastboot_session_t *fb)
+{
+	uint8_t *buf = fastboot_get_download_buffer(fb, NULL);
+
+	if (fb->stream)
+		lz4_decoder_init(fb->lz4, buf + FASTBOOT_STREAM_STAGE_SIZE,
+				 FASTBOOT_LZ4_WINDOW_SIZE, fastboot_lz4_flush,
+				 fb);
+	else
+		lz4_decoder_init(fb->lz4, buf, FASTBOOT_MAX_DOWNLOAD_SIZE,
+				 NULL, NULL);
+}
+
+static int fastboot_lz4_finish(fastboot_session_t *fb)
+{
+	uint64_t size;
+
+	if (lz4_decoder_finish(fb->lz4, &size)) {
+		fastboot_fail(fb, fb->lz4->error);
+		fastboot_lz4_end(fb);
+		fastboot_stream_end(fb);
+		return -1;
+	}
+
+	fb->download_len = size;
+	fastboot_lz4_end(fb);
+	return 0;
+}
+
+void fastboot_lz4_end(fastboot_session_t *fb)
+{
+	free(fb->lz4);
+	fb->lz4 = NULL;
+}
+
 /***************************** PROTOCOL HANDLING *****************************/
 
 static void fastboot_handle_download(fastboot_session_t *fb, void *data,
@@ -85,17 +135,35 @@ static void fastboot_handle_download(fastboot_session_t *fb, void *data,
 	uint64_t left = fb->download_len - fb->download_progress;
 	if (len > left) {
 		fastboot_fail(fb, "Too much data");
+		// Whatever was streamed so far can't be trusted any more.
+		fastboot_lz4_end(fb);
+		fastboot_stream_end(fb);
+		fb->download_progress = 0;
 		fb->state = COMMAND;
 		return;
 	}
 
-	void *buf = fastboot_get_download_buffer(fb, NULL);
-	memcpy(buf + fb->download_progress, data, len);
+	if (fb->lz4) {
+		// Errors are reported once the host has sent everything.
+		lz4_decoder_feed(fb->lz4, data, len);
+	} else if (fb->stream) {
+		fastboot_stream_feed(fb, data, len);
+	} else {
+		void *buf = fastboot_get_download_buffer(fb, NULL);
+		memcpy(buf + fb->download_progress, data, len);
+	}
 	fb->download_progress += len;
 	if (len == left) {
-		fb->has_download = true;
 		fb->download_progress = 0;
 		fb->state = COMMAND;
+		if (fb->lz4 && fastboot_lz4_finish(fb))
+			return;
+		if (fb->stream) {
+			if (fastboot_stream_finish(fb))
+				return;
+		} else {
+			fb->has_download = true;
+		}
 		fastboot_succeed(fb);
 	}
 }
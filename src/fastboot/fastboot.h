@@ -43,6 +43,8 @@
 
 #define FASTBOOT_MSG_MAX 64
 #define FASTBOOT_MAX_DOWNLOAD_SIZE ((uint64_t)CONFIG_KERNEL_SIZE)
+// How much of the download buffer a streamed download is staged in.
+#define FASTBOOT_STREAM_STAGE_SIZE (4 * MiB)
 
 enum fastboot_state {
 	// Expecting a command. This is the initial state.
@@ -55,6 +57,9 @@ enum fastboot_state {
 	REBOOT,
 };
 
+struct fastboot_stream;
+struct lz4_decoder;
+
 // State of a fastboot session.
 typedef struct fastboot_session {
 	// State of the session.
@@ -67,6 +72,11 @@ typedef struct fastboot_session {
 	uint64_t download_len;
 	// If state == DOWNLOAD, how much data have we received?
 	uint64_t download_progress;
+	// If set, downloads are written straight to disk instead of being
+	// kept in the download buffer.
+	struct fastboot_stream *stream;
+	// If set, the next download is LZ4 compressed.
+	struct lz4_decoder *lz4;
 } fastboot_session_t;
 
 // Have we exited fastboot? (e.g. user ran `fastboot continue`)
@@ -77,6 +87,9 @@ void fastboot_handle_packet(fastboot_session_t *fb, void *data, uint64_t len);
 void fastboot(void);
 // Get the download buffer and the length of the download if a download exists.
 void *fastboot_get_download_buffer(fastboot_session_t *fb, uint64_t *len);
+// Set up to decompress a download (see "oem download-lz4").
+void fastboot_lz4_begin_download(fastboot_session_t *fb);
+void fastboot_lz4_end(fastboot_session_t *fb);
 
 // Responses to the client.
 void fastboot_fail(fastboot_session_t *fb, const char *msg);
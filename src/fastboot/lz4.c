@@ -0,0 +1,407 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but without any warranty; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// A streaming decoder for the LZ4 frame format, as written by the lz4 tool:
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+//
+// libpayload's ulz4fn() needs the whole frame in memory, which defeats the
+// point of compressing a fastboot download. This one keeps no state beyond
+// the output it has already produced, so data can be decompressed as it
+// arrives. Checksums aren't verified; TCP already protects the data in
+// flight.
+
+#include <libpayload.h>
+#include <stdint.h>
+
+#include "fastboot/lz4.h"
+
+#define LZ4_FRAME_MAGIC 0x184d2204
+#define LZ4_SKIPPABLE_MAGIC 0x184d2a50
+#define LZ4_SKIPPABLE_MASK 0xfffffff0
+
+#define LZ4_FLG_VERSION_SHIFT 6
+#define LZ4_FLG_BLOCK_CHECKSUM (1 << 4)
+#define LZ4_FLG_CONTENT_SIZE (1 << 3)
+#define LZ4_FLG_CONTENT_CHECKSUM (1 << 2)
+#define LZ4_FLG_DICT_ID (1 << 0)
+#define LZ4_BD_MAX_SIZE_SHIFT 4
+
+#define LZ4_BLOCK_UNCOMPRESSED (1U << 31)
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LEN_MASK 0xf
+
+void lz4_decoder_init(struct lz4_decoder *d, void *out, uint64_t out_size,
+		      lz4_flush_t flush, void *ctx)
+{
+	memset(d, 0, sizeof(*d));
+	d->state = LZ4_MAGIC;
+	d->out = out;
+	d->out_size = out_size;
+	d->flush = flush;
+	d->ctx = ctx;
+}
+
+static int lz4_fail(struct lz4_decoder *d, const char *msg)
+{
+	d->error = msg;
+	d->state = LZ4_ERROR;
+	return -1;
+}
+
+static uint32_t lz4_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Make space in the output window. Returns how much there is, or 0.
+static uint64_t lz4_out_room(struct lz4_decoder *d)
+{
+	if (d->out_pos < d->out_size)
+		return d->out_size - d->out_pos;
+
+	if (!d->flush) {
+		lz4_fail(d, "Decompressed image is too big");
+		return 0;
+	}
+
+	// Keep enough behind to resolve any match.
+	uint64_t done = d->out_pos - LZ4_HISTORY_SIZE;
+	if (d->flush(d->ctx, d->out, done)) {
+		lz4_fail(d, "Failed to write");
+		return 0;
+	}
+	memmove(d->out, d->out + done, LZ4_HISTORY_SIZE);
+	d->out_pos = LZ4_HISTORY_SIZE;
+	d->out_flushed += done;
+	return d->out_size - d->out_pos;
+}
+
+static int lz4_out_copy(struct lz4_decoder *d, const uint8_t *data,
+			uint64_t len)
+{
+	while (len) {
+		uint64_t room = lz4_out_room(d);
+		if (!room)
+			return -1;
+		uint64_t copy = MIN(len, room);
+		memcpy(d->out + d->out_pos, data, copy);
+		d->out_pos += copy;
+		data += copy;
+		len -= copy;
+	}
+	return 0;
+}
+
+static int lz4_out_match(struct lz4_decoder *d, uint32_t offset)
+{
+	if (!offset || offset > d->out_pos)
+		return lz4_fail(d, "Corrupt LZ4 data");
+
+	while (d->match_len) {
+		uint64_t room = lz4_out_room(d);
+		if (!room)
+			return -1;
+		uint64_t copy = MIN(d->match_len, room);
+		uint8_t *dst = d->out + d->out_pos;
+		const uint8_t *src = dst - offset;
+		// Matches can overlap their own output, so go a byte at a
+		// time when they do.
+		if (offset >= copy) {
+			memcpy(dst, src, copy);
+		} else {
+			for (uint64_t i = 0; i < copy; i++)
+				dst[i] = src[i];
+		}
+		d->out_pos += copy;
+		d->match_len -= copy;
+	}
+	return 0;
+}
+
+// Gather a fixed size field. Returns true once all of it is there.
+static bool lz4_collect(struct lz4_decoder *d, const uint8_t **data,
+			uint64_t *len, uint32_t size)
+{
+	uint64_t copy = MIN(*len, size - d->field_len);
+
+	memcpy(d->field + d->field_len, *data, copy);
+	d->field_len += copy;
+	*data += copy;
+	*len -= copy;
+	return d->field_len == size;
+}
+
+// Take a byte of the current compressed block.
+static int lz4_block_byte(struct lz4_decoder *d, const uint8_t **data,
+			  uint64_t *len)
+{
+	if (!d->block_left)
+		return lz4_fail(d, "Corrupt LZ4 data");
+	d->block_left--;
+	(*len)--;
+	return *(*data)++;
+}
+
+static void lz4_block_end(struct lz4_decoder *d)
+{
+	if (d->frame_flags & LZ4_FLG_BLOCK_CHECKSUM)
+		d->state = LZ4_BLOCK_CHECKSUM;
+	else
+		d->state = LZ4_BLOCK_SIZE;
+}
+
+static void lz4_literals_done(struct lz4_decoder *d)
+{
+	// The last sequence of a block is only literals.
+	if (!d->block_left)
+		lz4_block_end(d);
+	else
+		d->state = LZ4_OFFSET;
+}
+
+static void lz4_match(struct lz4_decoder *d)
+{
+	uint32_t offset = d->field[0] | d->field[1] << 8;
+
+	d->field_len = 0;
+	d->match_len += LZ4_MIN_MATCH;
+	if (lz4_out_match(d, offset))
+		return;
+	// Blocks should end with literals, but don't insist on it.
+	if (d->block_left)
+		d->state = LZ4_TOKEN;
+	else
+		lz4_block_end(d);
+}
+
+static int lz4_frame_desc(struct lz4_decoder *d)
+{
+	uint8_t flg = d->field[0];
+	uint8_t bd = d->field[1];
+
+	if (flg >> LZ4_FLG_VERSION_SHIFT != 1)
+		return lz4_fail(d, "Unsupported LZ4 frame version");
+	if (flg & LZ4_FLG_DICT_ID)
+		return lz4_fail(d, "LZ4 dictionaries aren't supported");
+
+	switch ((bd >> LZ4_BD_MAX_SIZE_SHIFT) & 0x7) {
+	case 4:
+		d->block_max = 64 * KiB;
+		break;
+	case 5:
+		d->block_max = 256 * KiB;
+		break;
+	case 6:
+		d->block_max = 1 * MiB;
+		break;
+	case 7:
+		d->block_max = 4 * MiB;
+		break;
+	default:
+		return lz4_fail(d, "Bad LZ4 block size");
+	}
+
+	d->frame_flags = flg;
+	d->state = LZ4_BLOCK_SIZE;
+	return 0;
+}
+
+static int lz4_block_size(struct lz4_decoder *d)
+{
+	uint32_t size = lz4_le32(d->field);
+
+	if (!size) {
+		// End mark.
+		if (d->frame_flags & LZ4_FLG_CONTENT_CHECKSUM) {
+			d->state = LZ4_CONTENT_CHECKSUM;
+		} else {
+			d->state = LZ4_MAGIC;
+			d->frame_done = true;
+		}
+		return 0;
+	}
+
+	d->block_left = size & ~LZ4_BLOCK_UNCOMPRESSED;
+	if (d->block_left > d->block_max)
+		return lz4_fail(d, "LZ4 block too big");
+	d->state = size & LZ4_BLOCK_UNCOMPRESSED ? LZ4_BLOCK_RAW : LZ4_TOKEN;
+	return 0;
+}
+
+int lz4_decoder_feed(struct lz4_decoder *d, const void *buf, uint64_t len)
+{
+	const uint8_t *data = buf;
+
+	while (len && d->state != LZ4_ERROR) {
+		uint64_t copy;
+		int byte;
+
+		switch (d->state) {
+		case LZ4_MAGIC:
+			if (!lz4_collect(d, &data, &len, 4))
+				break;
+			d->field_len = 0;
+			d->frame_done = false;
+			uint32_t magic = lz4_le32(d->field);
+			if (magic == LZ4_FRAME_MAGIC)
+				d->state = LZ4_FRAME_DESC;
+			else if ((magic & LZ4_SKIPPABLE_MASK) ==
+				 LZ4_SKIPPABLE_MAGIC)
+				d->state = LZ4_SKIP_SIZE;
+			else
+				lz4_fail(d, "Not an LZ4 frame");
+			break;
+		case LZ4_SKIP_SIZE:
+			if (!lz4_collect(d, &data, &len, 4))
+				break;
+			d->field_len = 0;
+			d->skip_left = lz4_le32(d->field);
+			d->state = LZ4_SKIP;
+			d->frame_done = !d->skip_left;
+			if (d->frame_done)
+				d->state = LZ4_MAGIC;
+			break;
+		case LZ4_SKIP:
+			copy = MIN(len, d->skip_left);
+			data += copy;
+			len -= copy;
+			d->skip_left -= copy;
+			if (!d->skip_left) {
+				d->state = LZ4_MAGIC;
+				d->frame_done = true;
+			}
+			break;
+		case LZ4_FRAME_DESC: {
+			// FLG and BD, then the optional content size, then
+			// the header checksum. FLG says which are there.
+			uint32_t size = 3;
+			if (d->field_len && d->field[0] & LZ4_FLG_CONTENT_SIZE)
+				size += 8;
+			if (!lz4_collect(d, &data, &len,
+					 d->field_len ? size : 1) ||
+			    d->field_len < size)
+				break;
+			d->field_len = 0;
+			lz4_frame_desc(d);
+			break;
+		}
+		case LZ4_BLOCK_SIZE:
+			if (!lz4_collect(d, &data, &len, 4))
+				break;
+			d->field_len = 0;
+			lz4_block_size(d);
+			break;
+		case LZ4_BLOCK_RAW:
+			copy = MIN(len, d->block_left);
+			if (lz4_out_copy(d, data, copy))
+				break;
+			data += copy;
+			len -= copy;
+			d->block_left -= copy;
+			if (!d->block_left)
+				lz4_block_end(d);
+			break;
+		case LZ4_TOKEN:
+			if ((byte = lz4_block_byte(d, &data, &len)) < 0)
+				break;
+			d->literal_len = byte >> 4;
+			d->match_len = byte & LZ4_LEN_MASK;
+			if (d->literal_len == LZ4_LEN_MASK)
+				d->state = LZ4_LITERAL_LEN;
+			else if (d->literal_len)
+				d->state = LZ4_LITERALS;
+			else
+				lz4_literals_done(d);
+			break;
+		case LZ4_LITERAL_LEN:
+			if ((byte = lz4_block_byte(d, &data, &len)) < 0)
+				break;
+			d->literal_len += byte;
+			if (byte != 0xff)
+				d->state = LZ4_LITERALS;
+			break;
+		case LZ4_LITERALS:
+			copy = MIN(MIN(len, d->literal_len), d->block_left);
+			if (!copy) {
+				lz4_fail(d, "Corrupt LZ4 data");
+				break;
+			}
+			if (lz4_out_copy(d, data, copy))
+				break;
+			data += copy;
+			len -= copy;
+			d->block_left -= copy;
+			d->literal_len -= copy;
+			if (!d->literal_len)
+				lz4_literals_done(d);
+			break;
+		case LZ4_OFFSET:
+			if ((byte = lz4_block_byte(d, &data, &len)) < 0)
+				break;
+			d->field[d->field_len++] = byte;
+			if (d->field_len < 2)
+				break;
+			if (d->match_len == LZ4_LEN_MASK) {
+				d->state = LZ4_MATCH_LEN;
+				break;
+			}
+			lz4_match(d);
+			break;
+		case LZ4_MATCH_LEN:
+			if ((byte = lz4_block_byte(d, &data, &len)) < 0)
+				break;
+			d->match_len += byte;
+			if (byte == 0xff)
+				break;
+			lz4_match(d);
+			break;
+		case LZ4_BLOCK_CHECKSUM:
+			if (!lz4_collect(d, &data, &len, 4))
+				break;
+			d->field_len = 0;
+			d->state = LZ4_BLOCK_SIZE;
+			break;
+		case LZ4_CONTENT_CHECKSUM:
+			if (!lz4_collect(d, &data, &len, 4))
+				break;
+			d->field_len = 0;
+			d->state = LZ4_MAGIC;
+			d->frame_done = true;
+			break;
+		case LZ4_ERROR:
+			break;
+		}
+	}
+
+	return d->state == LZ4_ERROR ? -1 : 0;
+}
+
+int lz4_decoder_finish(struct lz4_decoder *d, uint64_t *size)
+{
+	if (d->state == LZ4_ERROR)
+		return -1;
+	if (d->state != LZ4_MAGIC || d->field_len || !d->frame_done)
+		return lz4_fail(d, "Compressed image ended abruptly");
+
+	if (d->flush && d->out_pos &&
+	    d->flush(d->ctx, d->out, d->out_pos))
+		return lz4_fail(d, "Failed to write");
+
+	*size = d->out_flushed + d->out_pos;
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but without any warranty; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __FASTBOOT_LZ4_H__
+#define __FASTBOOT_LZ4_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How far back an LZ4 match can reach.
+#define LZ4_HISTORY_SIZE (64 * 1024)
+
+enum lz4_state {
+	LZ4_MAGIC = 0,
+	LZ4_SKIP_SIZE,
+	LZ4_SKIP,
+	LZ4_FRAME_DESC,
+	LZ4_BLOCK_SIZE,
+	LZ4_BLOCK_RAW,
+	LZ4_TOKEN,
+	LZ4_LITERAL_LEN,
+	LZ4_LITERALS,
+	LZ4_OFFSET,
+	LZ4_MATCH_LEN,
+	LZ4_BLOCK_CHECKSUM,
+	LZ4_CONTENT_CHECKSUM,
+	LZ4_ERROR,
+};
+
+// Called with decompressed data that has left the output window.
+typedef int (*lz4_flush_t)(void *ctx, const void *data, uint64_t len);
+
+// Decompresses LZ4 frames which are fed to it in pieces of any size.
+struct lz4_decoder {
+	enum lz4_state state;
+
+	// Fixed size field being collected for the current state.
+	uint8_t field[15];
+	uint32_t field_len;
+
+	uint8_t frame_flags;
+	uint32_t block_max;
+	// Compressed bytes left in the current block.
+	uint32_t block_left;
+	// Bytes left in a skippable frame.
+	uint32_t skip_left;
+	uint32_t literal_len;
+	uint32_t match_len;
+	// Whether the input so far ends on a frame boundary.
+	bool frame_done;
+
+	// Output goes here. Once it fills up, everything but the last
+	// LZ4_HISTORY_SIZE bytes is passed to flush, if there is one.
+	uint8_t *out;
+	uint64_t out_size;
+	uint64_t out_pos;
+	// How much has been flushed.
+	uint64_t out_flushed;
+	lz4_flush_t flush;
+	void *ctx;
+
+	// Why decompression stopped, if state == LZ4_ERROR.
+	const char *error;
+};
+
+// With a flush function, out_size must be more than LZ4_HISTORY_SIZE.
+void lz4_decoder_init(struct lz4_decoder *d, void *out, uint64_t out_size,
+		      lz4_flush_t flush, void *ctx);
+// Returns 0 on success, or -1 with d->error set.
+int lz4_decoder_feed(struct lz4_decoder *d, const void *data, uint64_t len);
+// Flushes what's left and returns 0 and the decompressed size, or -1.
+int lz4_decoder_finish(struct lz4_decoder *d, uint64_t *size);
+
+#endif // __FASTBOOT_LZ4_H__
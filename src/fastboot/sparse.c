@@ -23,45 +23,6 @@
 
 /********************** Sparse Image Handling ****************************/
 
-/*
- * Sparse Image Header.
- * The canonical definition of the sparse format (including the magic values
- * from below) is in AOSP's libsparse:
- * https://android.googlesource.com/platform/system/core/+/refs/heads/master/libsparse/sparse_format.h
- */
-struct sparse_image_hdr {
-	/* Magic number for sparse image 0xed26ff3a. */
-	uint32_t magic;
-	/* Major version = 0x1 */
-	uint16_t major_version;
-	uint16_t minor_version;
-	uint16_t file_hdr_size;
-	uint16_t chunk_hdr_size;
-	/* Size of block in bytes. */
-	uint32_t blk_size;
-	/* # of blocks in the non-sparse image. */
-	uint32_t total_blks;
-	/* # of chunks in the sparse image. */
-	uint32_t total_chunks;
-	uint32_t image_checksum;
-};
-
-#define SPARSE_IMAGE_MAGIC 0xed26ff3a
-#define CHUNK_TYPE_RAW 0xCAC1
-#define CHUNK_TYPE_FILL 0xCAC2
-#define CHUNK_TYPE_DONT_CARE 0xCAC3
-#define CHUNK_TYPE_CRC32 0xCAC4
-
-/* Chunk header in sparse image */
-struct sparse_chunk_hdr {
-	uint16_t type;
-	uint16_t reserved;
-	/* Chunk size is in number of blocks */
-	uint32_t size_in_blks;
-	/* Size in bytes of chunk header and data */
-	uint32_t total_size_bytes;
-};
-
 /* Check if given image is sparse */
 int is_sparse_image(void *image_addr)
 {
@@ -72,65 +33,221 @@ int is_sparse_image(void *image_addr)
 		(hdr->major_version == 0x1));
 }
 
-struct img_buff {
-	void *data;
-	uint64_t size;
-};
+/* Write sparse image to partition */
+int write_sparse_image(fastboot_session_t *fb, struct fastboot_disk *disk,
+		       GptEntry *partition, void *image_addr,
+		       uint64_t image_size)
+{
+	struct image_writer w;
+
+	/*
+	 * Every chunk is already in memory, so it's written straight from
+	 * the download buffer and staging never needs more than a block.
+	 */
+	void *stage = xmalloc(disk->disk->block_size);
+	image_writer_init(&w, disk, partition, stage, disk->disk->block_size);
+
+	int ret = image_writer_feed(&w, image_addr, image_size);
+	if (!ret)
+		ret = image_writer_finish(&w);
+	free(stage);
+
+	if (ret)
+		fastboot_fail(fb, w.error);
+	return ret;
+}
+
+/************************* Streaming Image Writer **************************/
+
+void image_writer_init(struct image_writer *w, struct fastboot_disk *disk,
+		       GptEntry *partition, void *stage, uint64_t stage_size)
+{
+	memset(w, 0, sizeof(*w));
+	w->ops = &disk->disk->ops;
+	w->block_size = disk->disk->block_size;
+	w->lba = partition->starting_lba;
+	w->end_lba = partition->ending_lba + 1; // inclusive.
+	w->stage = stage;
+	w->stage_size = stage_size;
+	w->state = WRITER_IMAGE_HDR;
+	w->erase_zeroes = w->ops->erase && disk->disk->erase_zeroes;
+}
+
+static int writer_fail(struct image_writer *w, const char *msg)
+{
+	w->error = msg;
+	w->state = WRITER_ERROR;
+	return -1;
+}
+
+static int writer_flush_pending(struct image_writer *w)
+{
+	BlockDevOps *ops = w->ops;
+	lba_t count = w->pending_count;
+
+	if (!count)
+		return 0;
+	w->pending_count = 0;
+
+	if (w->pending_erase) {
+		FB_TRACE_SPARSE("Erase %llx + %llx\n", w->pending_lba, count);
+		if (ops->erase &&
+		    ops->erase(ops, w->pending_lba, count) == count)
+			return 0;
+		if (!w->pending_must_fill)
+			return 0;
+	}
+
+	FB_TRACE_SPARSE("Fill %llx + %llx with %x\n", w->pending_lba, count,
+			w->pending_fill);
+	if (ops->fill_write(ops, w->pending_lba, count, w->pending_fill) !=
+	    count)
+		return writer_fail(w, "Failed to write");
+	return 0;
+}
 
 /*
- * Initialize img_buff structure with passed in data and size. Verifies that
- * buff and data is not NULL.
- * Returns 0 on success and -1 on error.
+ * Add the current chunk to the pending fill or erase, if it can be merged
+ * with it, and otherwise start a new one.
  */
-static int img_buff_init(struct img_buff *buff, void *data, uint64_t size)
+static int writer_add_pending(struct image_writer *w, bool erase,
+			      uint32_t fill, bool must_fill)
 {
-	if ((buff == NULL) || (data == NULL))
+	if (w->pending_count &&
+	    (w->pending_erase != erase || w->pending_fill != fill) &&
+	    writer_flush_pending(w))
 		return -1;
 
-	buff->data = data;
-	buff->size = size;
+	if (!w->pending_count) {
+		w->pending_lba = w->lba;
+		w->pending_erase = erase;
+		w->pending_fill = fill;
+		w->pending_must_fill = false;
+	}
+	w->pending_count += w->chunk_lba;
+	w->pending_must_fill |= must_fill;
+	w->lba += w->chunk_lba;
+	return 0;
+}
+
+static int writer_write(struct image_writer *w, lba_t count, const void *data)
+{
+	if (writer_flush_pending(w))
+		return -1;
 
+	if (count > w->end_lba - w->lba)
+		return writer_fail(w, "Image is too big");
+
+	if (w->ops->write(w->ops, w->lba, count, data) != count)
+		return writer_fail(w, "Failed to write");
+
+	w->lba += count;
 	return 0;
 }
 
 /*
- * Obtain current pointer to data and advance data pointer by size. If there is
- * not enough data to advance, then it returns NULL.
+ * Write out every complete block in the staging buffer, and with pad set,
+ * also a trailing partial block padded with zeroes.
  */
-static void *img_buff_advance(struct img_buff *buff, uint64_t size)
+static int writer_flush(struct image_writer *w, bool pad)
 {
-	void *data;
+	uint64_t partial = w->staged % w->block_size;
 
-	if (buff->size < size)
-		return NULL;
+	if (pad && partial) {
+		memset(w->stage + w->staged, 0, w->block_size - partial);
+		w->staged += w->block_size - partial;
+		partial = 0;
+	}
 
-	data = buff->data;
-	buff->data = (uint8_t *)(buff->data) + size;
-	buff->size -= size;
+	lba_t blocks = w->staged / w->block_size;
+	if (!blocks)
+		return 0;
+	if (writer_write(w, blocks, w->stage))
+		return -1;
 
-	return data;
+	memmove(w->stage, w->stage + blocks * w->block_size, partial);
+	w->staged = partial;
+	return 0;
 }
 
-/* Write sparse image to partition */
-int write_sparse_image(fastboot_session_t *fb, struct fastboot_disk *disk,
-		       GptEntry *partition, void *image_addr,
-		       uint64_t image_size)
+/* Add image data which goes right after whatever was written or staged. */
+static int writer_data(struct image_writer *w, const uint8_t *data,
+		       uint64_t len)
 {
-	struct img_buff buff;
-	struct sparse_image_hdr *img_hdr;
-	struct sparse_chunk_hdr *chunk_hdr;
-	uint64_t bdev_block_size = disk->disk->block_size;
+	while (len) {
+		if (!w->staged && len >= w->stage_size) {
+			lba_t blocks = len / w->block_size;
+			if (writer_write(w, blocks, data))
+				return -1;
+			data += blocks * w->block_size;
+			len -= blocks * w->block_size;
+			continue;
+		}
 
-	if (img_buff_init(&buff, image_addr, image_size)) {
-		fastboot_fail(fb, "Image too small");
-		return -1;
+		uint64_t copy = MIN(len, w->stage_size - w->staged);
+		memcpy(w->stage + w->staged, data, copy);
+		w->staged += copy;
+		data += copy;
+		len -= copy;
+
+		if (w->staged == w->stage_size && writer_flush(w, false))
+			return -1;
 	}
 
-	img_hdr = img_buff_advance(&buff, sizeof(*img_hdr));
+	return 0;
+}
+
+/* Gather up to size bytes of a header. Returns how much of data was used. */
+static uint64_t writer_collect(struct image_writer *w, const uint8_t *data,
+			       uint64_t len, uint32_t size)
+{
+	uint64_t copy = MIN(len, size - w->hdr_len);
+
+	memcpy(w->hdr.bytes + w->hdr_len, data, copy);
+	w->hdr_len += copy;
+	return copy;
+}
+
+static void writer_next_chunk(struct image_writer *w)
+{
+	w->state = --w->chunks_left ? WRITER_CHUNK_HDR : WRITER_DONE;
+}
 
-	if (img_hdr == NULL) {
-		fastboot_fail(fb, "Image too small");
+static int writer_fill(struct image_writer *w)
+{
+	/* Raw chunks always end on a block boundary, so this writes it all. */
+	if (writer_flush(w, false))
 		return -1;
+
+	/* Erasing is much quicker than writing zeroes, where it's the same. */
+	if (!w->hdr.value && w->erase_zeroes)
+		return writer_add_pending(w, true, 0, true);
+	return writer_add_pending(w, false, w->hdr.value, true);
+}
+
+static int writer_dont_care(struct image_writer *w)
+{
+	/* CRC32 chunks usually cover nothing. */
+	if (!w->chunk_lba)
+		return 0;
+
+	if (CONFIG(FASTBOOT_SPARSE_DISCARD) && w->ops->erase)
+		return writer_add_pending(w, true, 0, false);
+
+	/* Leave the old contents alone. */
+	if (writer_flush_pending(w))
+		return -1;
+	w->lba += w->chunk_lba;
+	return 0;
+}
+
+static int writer_image_hdr(struct image_writer *w)
+{
+	struct sparse_image_hdr *img_hdr = &w->hdr.img;
+
+	if (!is_sparse_image(img_hdr)) {
+		w->state = WRITER_RAW;
+		return writer_data(w, w->hdr.bytes, w->hdr_len);
 	}
 
 	FB_TRACE_SPARSE("Magic          : %x\n", img_hdr->magic);
@@ -144,185 +261,191 @@ int write_sparse_image(fastboot_session_t *fb, struct fastboot_disk *disk,
 	FB_TRACE_SPARSE("Checksum       : %x\n", img_hdr->image_checksum);
 
 	/* Is image header size as expected? */
-	if (img_hdr->file_hdr_size != sizeof(*img_hdr)) {
-		fastboot_fail(fb, "Unsupported sparse image.");
-		return -1;
-	}
+	if (img_hdr->file_hdr_size != sizeof(*img_hdr))
+		return writer_fail(w, "Unsupported sparse image.");
 
 	/* Is image block size multiple of bdev block size? */
 	if (img_hdr->blk_size !=
-	    ALIGN_DOWN(img_hdr->blk_size, bdev_block_size)) {
-		fastboot_fail(fb, "Invalid block size for sparse image.");
-		return -1;
-	}
+	    ALIGN_DOWN(img_hdr->blk_size, w->block_size))
+		return writer_fail(w, "Invalid block size for sparse image.");
 
 	/* Is chunk header size as expected? */
-	if (img_hdr->chunk_hdr_size != sizeof(*chunk_hdr)) {
-		fastboot_fail(fb, "Chunk header wrong size");
-		return -1;
-	}
-
-	int i;
-	uint64_t part_addr = partition->starting_lba;
-	uint64_t part_size_lba = partition->ending_lba -
-				 partition->starting_lba + 1; // inclusive.
-	BlockDevOps *ops = &disk->disk->ops;
+	if (img_hdr->chunk_hdr_size != sizeof(struct sparse_chunk_hdr))
+		return writer_fail(w, "Chunk header wrong size");
 
-	/* Perform the following operation on each chunk */
-	for (i = 0; i < img_hdr->total_chunks; i++) {
-		/* Get chunk header */
-		chunk_hdr = img_buff_advance(&buff, sizeof(*chunk_hdr));
+	w->blk_size = img_hdr->blk_size;
+	w->chunks_left = img_hdr->total_chunks;
+	w->state = w->chunks_left ? WRITER_CHUNK_HDR : WRITER_DONE;
+	return 0;
+}
 
-		if (chunk_hdr == NULL) {
-			fastboot_fail(fb, "Sparse image ended abruptly");
-			return -1;
-		}
+static int writer_chunk_hdr(struct image_writer *w)
+{
+	struct sparse_chunk_hdr *chunk_hdr = &w->hdr.chunk;
+
+	FB_TRACE_SPARSE("Chunk %d\n", w->chunks_left);
+	FB_TRACE_SPARSE("Type         : %x\n", chunk_hdr->type);
+	FB_TRACE_SPARSE("Size in blks : %x\n", chunk_hdr->size_in_blks);
+	FB_TRACE_SPARSE("Total size   : %x\n", chunk_hdr->total_size_bytes);
+	FB_TRACE_SPARSE("Part addr    : %llx\n", w->lba);
+
+	/* Size in bytes and lba of the area occupied by chunk range */
+	uint64_t chunk_size_bytes =
+		(uint64_t)chunk_hdr->size_in_blks * w->blk_size;
+	w->chunk_lba = chunk_size_bytes / w->block_size;
+
+	/* Should not write past partition size */
+	lba_t pos = w->lba + w->staged / w->block_size;
+	if (w->end_lba - pos < w->chunk_lba) {
+		FB_TRACE_SPARSE("chunk_size_lba:%llx\n", w->chunk_lba);
+		return writer_fail(w, "Chunk too big");
+	}
 
-		FB_TRACE_SPARSE("Chunk %d\n", i);
-		FB_TRACE_SPARSE("Type         : %x\n", chunk_hdr->type);
-		FB_TRACE_SPARSE("Size in blks : %x\n", chunk_hdr->size_in_blks);
-		FB_TRACE_SPARSE("Total size   : %x\n",
-				chunk_hdr->total_size_bytes);
-		FB_TRACE_SPARSE("Part addr    : %llx\n", part_addr);
-
-		/* Size in bytes and lba of the area occupied by chunk range */
-		uint64_t chunk_size_bytes, chunk_size_lba;
-
-		chunk_size_bytes =
-			(uint64_t)chunk_hdr->size_in_blks * img_hdr->blk_size;
-		chunk_size_lba = chunk_size_bytes / bdev_block_size;
-
-		/* Should not write past partition size */
-		if (part_size_lba < chunk_size_lba) {
-			FB_TRACE_SPARSE("part_size_lba:%llx\n", part_size_lba);
-			FB_TRACE_SPARSE("chunk_size_lba:%llx\n",
-					chunk_size_lba);
-			fastboot_fail(fb, "Chunk too big");
+	switch (chunk_hdr->type) {
+	case CHUNK_TYPE_RAW:
+		/*
+		 * For Raw chunk type:
+		 * chunk_size_bytes + chunk_hdr_size = chunk_total_size
+		 */
+		if (chunk_size_bytes + sizeof(*chunk_hdr) !=
+		    chunk_hdr->total_size_bytes)
+			return writer_fail(w, "Chunk size is wrong");
+		w->chunk_left = chunk_size_bytes;
+		if (w->chunk_left)
+			w->state = WRITER_CHUNK_RAW;
+		else
+			writer_next_chunk(w);
+		return 0;
+	case CHUNK_TYPE_FILL:
+		/*
+		 * For fill chunk type:
+		 * chunk_hdr_size + 4 bytes = chunk_total_size_bytes
+		 */
+		if (sizeof(uint32_t) + sizeof(*chunk_hdr) !=
+		    chunk_hdr->total_size_bytes)
+			return writer_fail(w, "Chunk size is wrong");
+		w->state = WRITER_CHUNK_FILL;
+		return 0;
+	case CHUNK_TYPE_DONT_CARE:
+		/*
+		 * For dont care chunk type:
+		 * chunk_hdr_size = chunk_total_size_bytes
+		 * data in sparse image = 0 bytes
+		 */
+		if (sizeof(*chunk_hdr) != chunk_hdr->total_size_bytes)
+			return writer_fail(w, "Chunk size is wrong");
+		if (writer_dont_care(w))
 			return -1;
-		}
-
-		switch (chunk_hdr->type) {
-		case CHUNK_TYPE_RAW: {
-
-			uint8_t *data_ptr;
-
-			/*
-			 * For Raw chunk type:
-			 * chunk_size_bytes + chunk_hdr_size = chunk_total_size
-			 */
-			if ((chunk_size_bytes + sizeof(*chunk_hdr)) !=
-			    chunk_hdr->total_size_bytes) {
-				FB_TRACE_SPARSE("chunk_size_bytes:%llx\n",
-						chunk_size_bytes +
-							sizeof(*chunk_hdr));
-				FB_TRACE_SPARSE("total_size_bytes:%x\n",
-						chunk_hdr->total_size_bytes);
-				fastboot_fail(fb, "Chunk size is wrong");
-				return -1;
-			}
-
-			data_ptr = img_buff_advance(&buff, chunk_size_bytes);
-			if (data_ptr == NULL) {
-				fastboot_fail(fb,
-					      "Sparse image ended abruptly");
-				return -1;
-			}
+		writer_next_chunk(w);
+		return 0;
+	case CHUNK_TYPE_CRC32:
+		/*
+		 * For crc32 chunk type:
+		 * chunk_hdr_size + 4 bytes = chunk_total_size_bytes
+		 */
+		if (sizeof(uint32_t) + sizeof(*chunk_hdr) !=
+		    chunk_hdr->total_size_bytes)
+			return writer_fail(w, "Chunk size is wrong");
+		w->state = WRITER_CHUNK_CRC32;
+		return 0;
+	default:
+		/* Unknown chunk type */
+		FB_TRACE_SPARSE("Unknown chunk type %d\n", chunk_hdr->type);
+		return writer_fail(w, "Unrecognised chunk type");
+	}
+}
 
-			if (ops->write(ops, part_addr, chunk_size_lba,
-				       data_ptr) != chunk_size_lba) {
-				fastboot_fail(fb, "Failed to write");
-				return -1;
+int image_writer_feed(struct image_writer *w, const void *buf, uint64_t len)
+{
+	const uint8_t *data = buf;
+
+	while (len && w->state != WRITER_ERROR) {
+		uint64_t used = len;
+
+		switch (w->state) {
+		case WRITER_IMAGE_HDR:
+			used = writer_collect(w, data, len,
+					      sizeof(struct sparse_image_hdr));
+			if (w->hdr_len == sizeof(struct sparse_image_hdr)) {
+				writer_image_hdr(w);
+				w->hdr_len = 0;
 			}
-
 			break;
-		}
-		case CHUNK_TYPE_FILL: {
-
-			uint32_t *data_fill;
-
-			/*
-			 * For fill chunk type:
-			 * chunk_hdr_size + 4 bytes = chunk_total_size_bytes
-			 */
-			if (sizeof(uint32_t) + sizeof(*chunk_hdr) !=
-			    chunk_hdr->total_size_bytes) {
-				FB_TRACE_SPARSE("chunk_size_bytes:%zx\n",
-						sizeof(uint32_t) +
-							sizeof(*chunk_hdr));
-				FB_TRACE_SPARSE("total_size_bytes:%x\n",
-						chunk_hdr->total_size_bytes);
-				fastboot_fail(fb, "Chunk size is wrong");
-				return -1;
-			}
-
-			data_fill = img_buff_advance(&buff, sizeof(*data_fill));
-			if (!data_fill) {
-				fastboot_fail(fb,
-					      "Sparse image ended abruptly");
-				return -1;
-			}
-
-			/* Perform fill_write operation */
-			if (ops->fill_write(ops, part_addr, chunk_size_lba,
-					    *data_fill) != chunk_size_lba) {
-				fastboot_fail(fb, "Failed to write");
-				return -1;
-			}
-
+		case WRITER_RAW:
+			writer_data(w, data, len);
 			break;
-		}
-		case CHUNK_TYPE_DONT_CARE: {
-			/*
-			 * For dont care chunk type:
-			 * chunk_hdr_size = chunk_total_size_bytes
-			 * data in sparse image = 0 bytes
-			 */
-			if (sizeof(*chunk_hdr) != chunk_hdr->total_size_bytes) {
-				FB_TRACE_SPARSE("chunk_size_bytes:%zx\n",
-						sizeof(*chunk_hdr));
-				FB_TRACE_SPARSE("total_size_bytes:%x\n",
-						chunk_hdr->total_size_bytes);
-				fastboot_fail(fb, "Chunk size is wrong");
-				return -1;
+		case WRITER_CHUNK_HDR:
+			used = writer_collect(w, data, len,
+					      sizeof(struct sparse_chunk_hdr));
+			if (w->hdr_len == sizeof(struct sparse_chunk_hdr)) {
+				/*
+				 * Data of the previous chunk only needs
+				 * writing out now if this one isn't
+				 * contiguous with it.
+				 */
+				if (w->hdr.chunk.type != CHUNK_TYPE_RAW &&
+				    writer_flush(w, false))
+					break;
+				writer_chunk_hdr(w);
+				w->hdr_len = 0;
 			}
 			break;
-		}
-		case CHUNK_TYPE_CRC32: {
-			/*
-			 * For crc32 chunk type:
-			 * chunk_hdr_size + 4 bytes = chunk_total_size_bytes
-			 */
-			if (sizeof(uint32_t) + sizeof(*chunk_hdr) !=
-			    chunk_hdr->total_size_bytes) {
-				FB_TRACE_SPARSE("chunk_size_bytes:%zx\n",
-						sizeof(uint32_t) +
-							sizeof(*chunk_hdr));
-				FB_TRACE_SPARSE("total_size_bytes:%x\n",
-						chunk_hdr->total_size_bytes);
-				fastboot_fail(fb, "Chunk size is wrong");
-				return -1;
+		case WRITER_CHUNK_RAW:
+			used = MIN(len, w->chunk_left);
+			if (writer_data(w, data, used))
+				break;
+			w->chunk_left -= used;
+			if (!w->chunk_left)
+				writer_next_chunk(w);
+			break;
+		case WRITER_CHUNK_FILL:
+			used = writer_collect(w, data, len, sizeof(uint32_t));
+			if (w->hdr_len == sizeof(uint32_t)) {
+				if (!writer_fill(w))
+					writer_next_chunk(w);
+				w->hdr_len = 0;
 			}
-
-			/* Data present in chunk sparse image = 4 bytes */
-			if (img_buff_advance(&buff, sizeof(uint32_t)) == NULL) {
-				fastboot_fail(fb,
-					      "Sparse image ended abruptly");
-				return -1;
+			break;
+		case WRITER_CHUNK_CRC32:
+			used = writer_collect(w, data, len, sizeof(uint32_t));
+			if (w->hdr_len == sizeof(uint32_t)) {
+				if (!writer_dont_care(w))
+					writer_next_chunk(w);
+				w->hdr_len = 0;
 			}
 			break;
+		case WRITER_DONE:
+			/* Ignore anything after the last chunk. */
+			break;
+		case WRITER_ERROR:
+			break;
 		}
-		default: {
-			/* Unknown chunk type */
-			FB_TRACE_SPARSE("Unknown chunk type %d\n",
-					chunk_hdr->type);
-			fastboot_fail(fb, "Unrecognised chunk type");
-			return -1;
-		}
-		}
-		/* Update partition address and size accordingly */
-		part_addr += chunk_size_lba;
-		part_size_lba -= chunk_size_lba;
+
+		data += used;
+		len -= used;
 	}
 
-	return 0;
+	return w->state == WRITER_ERROR ? -1 : 0;
+}
+
+int image_writer_finish(struct image_writer *w)
+{
+	switch (w->state) {
+	case WRITER_IMAGE_HDR:
+		/* A raw image too small to hold a sparse header. */
+		w->state = WRITER_RAW;
+		if (writer_data(w, w->hdr.bytes, w->hdr_len))
+			return -1;
+		return writer_flush(w, true);
+	case WRITER_RAW:
+		return writer_flush(w, true);
+	case WRITER_DONE:
+		if (writer_flush(w, false))
+			return -1;
+		return writer_flush_pending(w);
+	case WRITER_ERROR:
+		return -1;
+	default:
+		return writer_fail(w, "Sparse image ended abruptly");
+	}
 }
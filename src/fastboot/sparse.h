@@ -27,9 +27,131 @@
 #define FB_TRACE_SPARSE(...)
 #endif
 
+/*
+ * Sparse Image Header.
+ * The canonical definition of the sparse format (including the magic values
+ * from below) is in AOSP's libsparse:
+ * https://android.googlesource.com/platform/system/core/+/refs/heads/master/libsparse/sparse_format.h
+ */
+struct sparse_image_hdr {
+	/* Magic number for sparse image 0xed26ff3a. */
+	uint32_t magic;
+	/* Major version = 0x1 */
+	uint16_t major_version;
+	uint16_t minor_version;
+	uint16_t file_hdr_size;
+	uint16_t chunk_hdr_size;
+	/* Size of block in bytes. */
+	uint32_t blk_size;
+	/* # of blocks in the non-sparse image. */
+	uint32_t total_blks;
+	/* # of chunks in the sparse image. */
+	uint32_t total_chunks;
+	uint32_t image_checksum;
+};
+
+#define SPARSE_IMAGE_MAGIC 0xed26ff3a
+#define CHUNK_TYPE_RAW 0xCAC1
+#define CHUNK_TYPE_FILL 0xCAC2
+#define CHUNK_TYPE_DONT_CARE 0xCAC3
+#define CHUNK_TYPE_CRC32 0xCAC4
+
+/* Chunk header in sparse image */
+struct sparse_chunk_hdr {
+	uint16_t type;
+	uint16_t reserved;
+	/* Chunk size is in number of blocks */
+	uint32_t size_in_blks;
+	/* Size in bytes of chunk header and data */
+	uint32_t total_size_bytes;
+};
+
+enum image_writer_state {
+	/* Collecting the start of the image to tell if it's sparse. */
+	WRITER_IMAGE_HDR = 0,
+	/* Not a sparse image, everything is data. */
+	WRITER_RAW,
+	WRITER_CHUNK_HDR,
+	WRITER_CHUNK_RAW,
+	WRITER_CHUNK_FILL,
+	WRITER_CHUNK_CRC32,
+	/* All chunks of a sparse image have been handled. */
+	WRITER_DONE,
+	WRITER_ERROR,
+};
+
+/*
+ * Writes a raw or sparse image to a partition as it is fed in, in any size
+ * of pieces. Data is gathered in the staging buffer and written out when it
+ * fills up or the destination stops being contiguous. Pieces at least as big
+ * as the staging buffer are written straight from the caller's memory.
+ */
+struct image_writer {
+	BlockDevOps *ops;
+	uint64_t block_size;
+	/* Where the data at the start of the staging buffer goes. */
+	lba_t lba;
+	/* One past the last block of the partition. */
+	lba_t end_lba;
+
+	uint8_t *stage;
+	uint64_t stage_size;
+	uint64_t staged;
+
+	enum image_writer_state state;
+	/* Header or value being collected for the current state. */
+	union {
+		struct sparse_image_hdr img;
+		struct sparse_chunk_hdr chunk;
+		uint32_t value;
+		uint8_t bytes[sizeof(struct sparse_image_hdr)];
+	} hdr;
+	uint32_t hdr_len;
+
+	uint32_t blk_size;
+	uint32_t chunks_left;
+	/* Size of the current chunk, in blocks and in bytes still to come. */
+	lba_t chunk_lba;
+	uint64_t chunk_left;
+
+	/*
+	 * Fill or erase made up of the chunks just before w->lba, held back
+	 * so that runs of them turn into a single command.
+	 */
+	lba_t pending_lba;
+	lba_t pending_count;
+	bool pending_erase;
+	/* Pattern to fill with, or for an erase, what to fill with instead. */
+	uint32_t pending_fill;
+	/* If the erase fails, the blocks have to be filled instead. */
+	bool pending_must_fill;
+	/* Whether erased blocks read back as zeroes. */
+	bool erase_zeroes;
+
+	/* Why the writer stopped, if state == WRITER_ERROR. */
+	const char *error;
+};
+
+/* A download being written to disk as it arrives. See "oem stream-flash". */
+struct fastboot_stream {
+	struct fastboot_disk disk;
+	GptEntry *partition;
+	struct image_writer writer;
+	/* Set once a download has been written successfully. */
+	bool done;
+};
+
 int is_sparse_image(void *image_addr);
 int write_sparse_image(fastboot_session_t *fb, struct fastboot_disk *disk,
 		       GptEntry *partition, void *image_addr,
 		       uint64_t image_size);
 
+/* stage_size must be a multiple of the disk's block size. */
+void image_writer_init(struct image_writer *w, struct fastboot_disk *disk,
+		       GptEntry *partition, void *stage, uint64_t stage_size);
+/* Returns 0 on success, or -1 with w->error set. */
+int image_writer_feed(struct image_writer *w, const void *data, uint64_t len);
+/* Writes out anything still staged. Returns 0 on success, or -1. */
+int image_writer_finish(struct image_writer *w);
+
 #endif // __FASTBOOT_SPARSE_H__
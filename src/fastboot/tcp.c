@@ -24,6 +24,7 @@
 #include "drivers/net/net.h"
 #include "drivers/power/power.h"
 #include "endian.h"
+#include "fastboot/disk.h"
 #include "fastboot/fastboot.h"
 #include "net/net.h"
 #include "net/uip.h"
@@ -80,8 +81,16 @@ static void fastboot_tcp_reset_session(struct fastboot_tcp_session *tcp)
 		fastboot_tcp_packet_destroy(top);
 	}
 
+	// The host tool makes a new connection for each invocation, so an
+	// armed "oem stream-flash" or "oem download-lz4" has to outlive this
+	// one.
+	struct fastboot_stream *stream = tcp->fb_session.stream;
+	struct lz4_decoder *lz4 = tcp->fb_session.lz4;
+
 	// Reset everything to its initial state.
 	memset(tcp, 0, sizeof(*tcp));
+	tcp->fb_session.stream = stream;
+	tcp->fb_session.lz4 = lz4;
 }
 
 // Send a single packet from the packet queue if we can.
@@ -325,7 +334,8 @@ void fastboot_over_tcp(void)
 
 	uip_ipaddr_t my_ip, next_ip, server_ip;
 	const char *dhcp_bootfile;
-	while (try_dhcp(&my_ip, &next_ip, &server_ip, &dhcp_bootfile))
+	while (try_dhcp(&my_ip, &next_ip, &server_ip, &dhcp_bootfile,
+			NULL))
 		printf("Dhcp failed, retrying.\n");
 
 	memset(&tcp_session, 0, sizeof(tcp_session));
@@ -334,8 +344,10 @@ void fastboot_over_tcp(void)
 
 	net_set_callback(fastboot_tcp_net_callback);
 	while (!fastboot_is_finished(&tcp_session.fb_session))
-		net_poll();
+		net_poll_all();
 	net_set_callback(NULL);
+	fastboot_stream_end(&tcp_session.fb_session);
+	fastboot_lz4_end(&tcp_session.fb_session);
 	printf("fastboot done.\n");
 	if (tcp_session.fb_session.state == REBOOT)
 		reboot();
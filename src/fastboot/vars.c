@@ -34,6 +34,7 @@
 	}
 static fastboot_getvar_info_t fastboot_vars[] = {
 	VAR_NO_ARGS("max-download-size", VAR_DOWNLOAD_SIZE),
+	VAR_NO_ARGS("oem-download-lz4", VAR_DOWNLOAD_LZ4),
 	VAR_NO_ARGS("product", VAR_PRODUCT),
 	VAR_NO_ARGS("secure", VAR_SECURE),
 	VAR_NO_ARGS("slot-count", VAR_SLOT_COUNT),
@@ -113,6 +114,9 @@ fastboot_getvar_result_t fastboot_getvar(fastboot_var_t var, const char *arg,
 		used_len = snprintf(outbuf, *outbuf_len, "%llu",
 				    FASTBOOT_MAX_DOWNLOAD_SIZE);
 		break;
+	case VAR_DOWNLOAD_LZ4:
+		used_len = snprintf(outbuf, *outbuf_len, "yes");
+		break;
 	case VAR_PRODUCT: {
 		struct cb_mainboard *mainboard =
 			phys_to_virt(lib_sysinfo.cb_mainboard);
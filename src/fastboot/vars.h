@@ -24,6 +24,7 @@
 
 typedef enum fastboot_var {
 	VAR_DOWNLOAD_SIZE,
+	VAR_DOWNLOAD_LZ4,
 	VAR_PRODUCT,
 	VAR_SECURE,
 	VAR_SLOT_COUNT,
@@ -107,6 +107,12 @@ struct uip_eth_addr uip_ethaddr = {{CONFIG_UIP_ETHADDR0,
 /* The packet buffer that contains incoming packets. */
 uip_buf_t uip_aligned_buf;
 
+/* Send a pure ACK at least this often while ACKs are being coalesced,
+   as RFC 1122 asks for. */
+#define UIP_MAX_DELAYED_ACKS 2
+uint8_t uip_ack_coalesce;
+uint8_t *uip_buf = uip_aligned_buf.u8;
+
 void *uip_appdata;               /* The uip_appdata pointer points to
 				    application data. */
 void *uip_sappdata;              /* The uip_appdata pointer points to
@@ -230,35 +236,68 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if !UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
+/*
+ * Unaligned loads. The compiler turns these into plain loads wherever the
+ * CPU allows it, and byte loads elsewhere.
+ */
+struct chksum_u64 { uint64_t v; } __attribute__((packed, may_alias));
+struct chksum_u32 { uint32_t v; } __attribute__((packed, may_alias));
+struct chksum_u16 { uint16_t v; } __attribute__((packed, may_alias));
+
+/*
+ * The one's complement sum doesn't care which byte order the 16 bit words
+ * are added in (RFC 1071), so add the data as native 32 bit words into a
+ * 64 bit accumulator and fold the carries back in once at the end. On a
+ * little endian CPU the result comes out byte swapped, as does the sum we
+ * start from, which UIP_HTONS() takes care of.
+ */
 static uint16_t
 chksum(uint16_t sum, const uint8_t *data, uint16_t len)
 {
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
+  uint64_t acc;
+  uint64_t w0, w1, w2, w3;
+  uint8_t last[2];
+
+  acc = UIP_HTONS(sum);
+
+  while(len >= 32) {
+    w0 = ((const struct chksum_u64 *)data)[0].v;
+    w1 = ((const struct chksum_u64 *)data)[1].v;
+    w2 = ((const struct chksum_u64 *)data)[2].v;
+    w3 = ((const struct chksum_u64 *)data)[3].v;
+    acc += (w0 & 0xffffffff) + (w0 >> 32);
+    acc += (w1 & 0xffffffff) + (w1 >> 32);
+    acc += (w2 & 0xffffffff) + (w2 >> 32);
+    acc += (w3 & 0xffffffff) + (w3 >> 32);
+    data += 32;
+    len -= 32;
+  }
 
-  dataptr = data;
-  last_byte = data + len - 1;
-  
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
+  while(len >= 4) {
+    acc += ((const struct chksum_u32 *)data)->v;
+    data += 4;
+    len -= 4;
   }
-  
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
+
+  if(len >= 2) {
+    acc += ((const struct chksum_u16 *)data)->v;
+    data += 2;
+    len -= 2;
+  }
+
+  if(len) {
+    /* Pad an odd trailing byte with a zero. */
+    last[0] = *data;
+    last[1] = 0;
+    acc += ((const struct chksum_u16 *)last)->v;
+  }
+
+  while(acc >> 16) {
+    acc = (acc & 0xffff) + (acc >> 16);
   }
 
   /* Return sum in host byte order. */
-  return sum;
+  return UIP_HTONS((uint16_t)acc);
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
@@ -628,7 +667,16 @@ uip_process(uint8_t flag)
       goto tcp_send_syn;
     }
     goto drop;
-    
+
+    /* Check if we were invoked to send an ACK that was held back. */
+  } else if(flag == UIP_ACK_REQUEST) {
+    if(uip_connr->ack_pending &&
+       (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+      goto tcp_send_ack;
+    }
+    uip_connr->ack_pending = 0;
+    goto drop;
+
     /* Check if we were invoked because of the perodic timer fireing. */
   } else if(flag == UIP_TIMER) {
     if (CONFIG_UIP_REASSEMBLY && uip_reasstmr != 0) {
@@ -1529,6 +1577,12 @@ uip_process(uint8_t flag)
       /* If there is no data to send, just send out a pure ACK if
 	 there is newdata. */
       if(uip_flags & UIP_NEWDATA) {
+	/* When coalescing ACKs, only acknowledge every other segment
+	   here and leave the rest to uip_ack_conn(). */
+	if(uip_ack_coalesce &&
+	   ++uip_connr->ack_pending < UIP_MAX_DELAYED_ACKS) {
+	  goto drop;
+	}
 	uip_len = UIP_TCPIP_HLEN;
 	BUF->flags = TCP_ACK;
 	goto tcp_send_noopts;
@@ -1628,6 +1682,9 @@ uip_process(uint8_t flag)
   BUF->seqno[2] = uip_connr->snd_nxt[2];
   BUF->seqno[3] = uip_connr->snd_nxt[3];
 
+  /* Every segment we send acknowledges everything received so far. */
+  uip_connr->ack_pending = 0;
+
   BUF->proto = UIP_PROTO_TCP;
   
   BUF->srcport  = uip_connr->lport;
@@ -379,6 +379,28 @@ void uip_setipid(uint16_t id);
 #define uip_poll_conn(conn) do { uip_conn = conn;       \
     uip_process(UIP_POLL_REQUEST); } while (0)
 
+/**
+ * Send an ACK for a connection if one was held back.
+ *
+ * While uip_ack_coalesce is set, uIP doesn't acknowledge every
+ * incoming data segment immediately. Once the caller has processed
+ * all the frames it has on hand, it should call this for every
+ * connection and send out any resulting packet, so that the sender
+ * doesn't stall waiting for an ACK.
+ *
+ * \param conn A pointer to the uip_conn struct for the connection.
+ *
+ * \hideinitializer
+ */
+#define uip_ack_conn(conn) do { uip_conn = conn;        \
+    uip_process(UIP_ACK_REQUEST); } while (0)
+
+/**
+ * Whether pure ACKs for incoming data may be held back for
+ * uip_ack_conn() to send later.
+ */
+extern uint8_t uip_ack_coalesce;
+
 /**
  * Periodic processing for a UDP connection identified by its number.
  *
@@ -466,7 +488,13 @@ typedef union {
 } uip_buf_t;
 
 extern uip_buf_t uip_aligned_buf;
-#define uip_buf (uip_aligned_buf.u8)
+
+/*
+ * Normally points at uip_aligned_buf, but may be pointed directly at a
+ * frame in a network driver's receive buffer while it is processed, to
+ * avoid copying it. See net_poll().
+ */
+extern uint8_t *uip_buf;
 
 
 /** @} */
@@ -1250,6 +1278,8 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. */
+  uint8_t ack_pending;   /**< The number of received segments we haven't
+			 sent an ACK for yet. */
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
@@ -1470,6 +1500,8 @@ void uip_process(uint8_t flag);
 				   should be constructed in the
 				   uip_buf buffer. */
 #define UIP_UDP_TIMER     5
+#define UIP_ACK_REQUEST   6     /* Tells uIP to send any ACK that was
+				   held back for a connection. */
 
 /* The TCP states used in the uip_conn->tcpstateflags. */
 #define UIP_CLOSED      0
@@ -65,7 +65,9 @@ typedef uint32_t uip_stats_t;
 
 #if CONFIG_UIP_DEFAULT_RECEIVE_WINDOW
 #undef CONFIG_UIP_RECEIVE_WINDOW
-#define CONFIG_UIP_RECEIVE_WINDOW (CONFIG_UIP_TCP_MSS)
+#define CONFIG_UIP_RECEIVE_WINDOW \
+	(CONFIG_UIP_RECEIVE_WINDOW_SEGMENTS * CONFIG_UIP_TCP_MSS > 0xffff ? \
+	 0xffff : CONFIG_UIP_RECEIVE_WINDOW_SEGMENTS * CONFIG_UIP_TCP_MSS)
 #endif
 
 #if CONFIG_UIP_DEFAULT_BUFSIZE
@@ -42,6 +42,10 @@ static const uint16_t DhcpClientPort = 68;
 
 // Wait for a response for 3 seconds before resending a request.
 static const uint64_t DhcpRespTimeoutUs = 3 * 1000 * 1000;
+// When asking for a cached lease back, resend more often and give up soon,
+// since the fallback is just to start over with a discover.
+static const uint64_t DhcpRebootRespTimeoutUs = 500 * 1000;
+static const int DhcpRebootTries = 3;
 
 typedef struct __attribute__((packed)) DhcpPacket
 {
@@ -358,8 +362,11 @@ static void dhcp_callback(void)
 	dhcp_in_ready = 1;
 }
 
-static void dhcp_send_packet(struct uip_udp_conn *conn, const char *name,
-			     DhcpPacket *out, DhcpPacket *in)
+// Send a packet and wait for a reply, resending it every timeout_us. Returns
+// 0 once there's a reply, or 1 after sending it "tries" times (if non-zero).
+static int dhcp_send_packet(struct uip_udp_conn *conn, const char *name,
+			    DhcpPacket *out, DhcpPacket *in,
+			    uint64_t timeout_us, int tries)
 {
 	// Send the outbound packet.
 	printf("Sending %s... ", name);
@@ -379,14 +386,19 @@ static void dhcp_send_packet(struct uip_udp_conn *conn, const char *name,
 		do {
 			net_poll();
 		} while (!dhcp_in_ready &&
-			 timer_us(start) < DhcpRespTimeoutUs);
-		if (dhcp_in_ready)
+			 timer_us(start) < timeout_us);
+		if (dhcp_in_ready || (tries && !--tries))
 			break;
 		// No response, try again.
 		uip_udp_packet_send(conn, out, sizeof(*out));
 	}
 	net_set_callback(NULL);
+	if (!dhcp_in_ready) {
+		printf("timed out.\n");
+		return 1;
+	}
 	printf("done.\n");
+	return 0;
 }
 
 static void dhcp_prep_packet(DhcpPacket *packet, uint32_t transaction_id)
@@ -417,8 +429,51 @@ static void dhcp_add_option(uint8_t **options, uint8_t tag, void *value,
 	*options += length + 2;
 }
 
+// Ask for the address in a saved lease without going through discovery first
+// (the INIT-REBOOT state in RFC 2131). Returns 0 if the server acked it.
+static int dhcp_init_reboot(struct uip_udp_conn *conn, const DhcpLease *lease,
+			    DhcpPacket *out, DhcpPacket *in,
+			    uint8_t *client_id, int client_id_size,
+			    uint8_t *requested, int requested_size,
+			    uint16_t *max_size)
+{
+	uint8_t byte = DhcpRequest;
+
+	dhcp_state = DhcpRequesting;
+	dhcp_prep_packet(out, rand());
+	uint8_t *options = out->options;
+	int remaining = sizeof(out->options);
+	dhcp_add_option(&options, DhcpTagMessageType, &byte, sizeof(byte),
+			&remaining);
+	dhcp_add_option(&options, DhcpTagClientIdentifier, client_id,
+			client_id_size, &remaining);
+	dhcp_add_option(&options, DhcpTagRequestedIpAddress,
+			(void *)&lease->client_ip, sizeof(lease->client_ip),
+			&remaining);
+	dhcp_add_option(&options, DhcpTagParameterRequestList, requested,
+			requested_size, &remaining);
+	dhcp_add_option(&options, DhcpTagMaximumDhcpMessageSize,
+			max_size, sizeof(*max_size), &remaining);
+	dhcp_add_option(&options, DhcpTagEndOfList, NULL, 0, &remaining);
+	if (dhcp_send_packet(conn, "DHCP request for saved lease", out, in,
+			     DhcpRebootRespTimeoutUs, DhcpRebootTries))
+		goto fail;
+
+	DhcpMessageType type = DhcpNoMessageType;
+	if (dhcp_process_options(in, OptionOverloadNone, &dhcp_get_type,
+				 &type) || type != DhcpAck) {
+		printf("Saved lease refused by the server.\n");
+		goto fail;
+	}
+	return 0;
+
+fail:
+	dhcp_state = DhcpInit;
+	return 1;
+}
+
 int dhcp_request(uip_ipaddr_t *next_ip, uip_ipaddr_t *server_ip,
-		 const char **bootfile)
+		 const char **bootfile, DhcpLease *lease)
 {
 	DhcpPacket out, in;
 	uint8_t byte;
@@ -441,6 +496,19 @@ int dhcp_request(uip_ipaddr_t *next_ip, uip_ipaddr_t *server_ip,
 	}
 	uip_udp_bind(conn, htonw(DhcpClientPort));
 
+	uint32_t server_id = 0;
+	if (lease && lease->client_ip &&
+	    !memcmp(lease->client_hw_addr, &uip_ethaddr,
+		    sizeof(lease->client_hw_addr)) &&
+	    !dhcp_init_reboot(conn, lease, &out, &in, client_id,
+			      sizeof(client_id), requested, sizeof(requested),
+			      &max_size)) {
+		// The ack should say who sent it, but it isn't critical.
+		dhcp_process_options(&in, OptionOverloadNone,
+				     &dhcp_get_server, &server_id);
+		goto acked;
+	}
+
 	// Send a DHCP discover packet.
 	dhcp_prep_packet(&out, rand());
 	options = out.options;
@@ -455,10 +523,10 @@ int dhcp_request(uip_ipaddr_t *next_ip, uip_ipaddr_t *server_ip,
 	dhcp_add_option(&options, DhcpTagMaximumDhcpMessageSize,
 			&max_size, sizeof(max_size), &remaining);
 	dhcp_add_option(&options, DhcpTagEndOfList, NULL, 0, &remaining);
-	dhcp_send_packet(conn, "DHCP discover", &out, &in);
+	dhcp_send_packet(conn, "DHCP discover", &out, &in,
+			 DhcpRespTimeoutUs, 0);
 
 	// Extract the DHCP server id.
-	uint32_t server_id;
 	if (dhcp_process_options(&in, OptionOverloadNone, &dhcp_get_server,
 				 &server_id)) {
 		printf("Failed to extract server id.\n");
@@ -484,7 +552,8 @@ int dhcp_request(uip_ipaddr_t *next_ip, uip_ipaddr_t *server_ip,
 	dhcp_add_option(&options, DhcpTagServerIdentifier,
 			&server_id, sizeof(server_id), &remaining);
 	dhcp_add_option(&options, DhcpTagEndOfList, NULL, 0, &remaining);
-	dhcp_send_packet(conn, "DHCP request", &out, &in);
+	dhcp_send_packet(conn, "DHCP request", &out, &in,
+			 DhcpRespTimeoutUs, 0);
 
 	DhcpMessageType type;
 	if (dhcp_process_options(&in, OptionOverloadNone, &dhcp_get_type,
@@ -499,6 +568,7 @@ int dhcp_request(uip_ipaddr_t *next_ip, uip_ipaddr_t *server_ip,
 		return 1;
 	}
 
+acked:
 	// The server acked, completing the transaction.
 	dhcp_state = DhcpBound;
 	uip_udp_remove(conn);
@@ -526,6 +596,17 @@ int dhcp_request(uip_ipaddr_t *next_ip, uip_ipaddr_t *server_ip,
 			   in.your_ip >> 16, in.your_ip >> 24);
 	uip_sethostaddr(&my_ip);
 
+	if (lease) {
+		memset(lease, 0, sizeof(*lease));
+		memcpy(lease->client_hw_addr, &uip_ethaddr,
+		       sizeof(lease->client_hw_addr));
+		lease->client_ip = in.your_ip;
+		lease->server_id = server_id;
+		lease->next_ip = in.server_ip;
+		memcpy(lease->bootfile_name, in.bootfile_name,
+		       sizeof(lease->bootfile_name));
+	}
+
 	return 0;
 }
 
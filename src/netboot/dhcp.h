@@ -22,8 +22,22 @@
 
 #include "net/uip.h"
 
+// What's needed to ask for the same address again on the next boot. The
+// addresses are in network byte order, as in a DHCP packet.
+typedef struct __attribute__((packed)) DhcpLease
+{
+	uint8_t client_hw_addr[6];
+	uint8_t reserved[2];
+	uint32_t client_ip;
+	uint32_t server_id;
+	uint32_t next_ip;
+	uint8_t bootfile_name[128];
+} DhcpLease;
+
+// If lease is set and holds a lease for this interface, ask for that address
+// back first. On success, lease is updated with the one that was granted.
 int dhcp_request(uip_ipaddr_t *next_ip, uip_ipaddr_t *server_ip,
-		 const char **bootfile);
+		 const char **bootfile, DhcpLease *lease);
 int dhcp_release(uip_ipaddr_t server_ip);
 
 #endif /* __NETBOOT_DHCP_H__ */
@@ -0,0 +1,441 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but without any warranty; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <endian.h>
+#include <libpayload.h>
+#include <stdint.h>
+
+#include "drivers/net/net.h"
+#include "net/net.h"
+#include "net/uip.h"
+#include "net/uip_arp.h"
+#include "net/uiplib.h"
+#include "netboot/http.h"
+
+// How often to run the uIP TCP timers (SYN and data retransmission).
+static const uint64_t HttpPeriodicUs = 500 * USECS_PER_MSEC;
+// Give up on a connection if the server goes quiet for this long.
+static const uint64_t HttpIdleTimeoutUs = 10 * USECS_PER_SEC;
+// How many times to reconnect and resume after losing a connection.
+static const int HttpMaxRetries = 5;
+
+static const char HttpScheme[] = "http://";
+
+typedef enum HttpStatus
+{
+	HttpPending = 0,
+	HttpSuccess = 1,
+	HttpFailure = 2,
+	HttpConnectionLost = 3
+} HttpStatus;
+
+static HttpStatus http_status;
+
+static struct uip_conn *http_conn;
+static char http_request[512];
+static int http_request_len;
+static int http_got_response;
+static int http_abort_requested;
+
+static uint8_t *http_dest;
+static uint32_t http_max_size;
+// Number of bytes of the file stored at http_dest so far.
+static uint32_t http_offset;
+// Total size of the file, once a response header has told us.
+static uint32_t http_total_size;
+static int http_have_size;
+
+// Response header accumulated across segments.
+static char http_header[1024];
+static int http_header_len;
+static int http_in_body;
+
+int http_is_url(const char *name)
+{
+	return name && !strncasecmp(name, HttpScheme, sizeof(HttpScheme) - 1);
+}
+
+static void http_send_packet(void)
+{
+	if (uip_len > 0) {
+		uip_arp_out();
+		net_send(uip_buf, uip_len);
+	}
+}
+
+// Find the value of a header line, or return NULL if it isn't this header.
+static const char *http_header_value(const char *line, const char *name)
+{
+	int name_len = strlen(name);
+
+	if (strncasecmp(line, name, name_len) || line[name_len] != ':')
+		return NULL;
+	line += name_len + 1;
+	while (*line == ' ' || *line == '\t')
+		line++;
+	return line;
+}
+
+// Parse a complete response header. Returns 0 if the body can follow.
+static int http_parse_header(void)
+{
+	char *line = http_header;
+	char *next = strstr(line, "\r\n");
+	*next = '\0';
+
+	unsigned int code;
+	if (strncmp(line, "HTTP/1.", 7) || strlen(line) < 12 ||
+	    (code = strtoul(line + 9, NULL, 10)) == 0) {
+		printf("Malformed HTTP status line: %s\n", line);
+		return -1;
+	}
+
+	if (code == 200) {
+		// The server ignored the range (or we didn't ask for one), so
+		// the body is the whole file.
+		http_offset = 0;
+	} else if (code != 206 || !http_offset) {
+		printf("HTTP request failed: %s\n", line);
+		return -1;
+	}
+
+	int have_length = 0;
+	uint32_t length = 0;
+	int have_range = 0;
+	uint32_t range_start = 0, range_total = 0;
+
+	for (line = next + 2; *line; line = next + 2) {
+		next = strstr(line, "\r\n");
+		*next = '\0';
+
+		const char *value;
+		if ((value = http_header_value(line, "Content-Length"))) {
+			length = strtoul(value, NULL, 10);
+			have_length = 1;
+		} else if ((value = http_header_value(line,
+						      "Content-Range"))) {
+			if (strncasecmp(value, "bytes ", 6))
+				continue;
+			char *end;
+			range_start = strtoul(value + 6, &end, 10);
+			end = strchr(end, '/');
+			if (!end)
+				continue;
+			range_total = strtoul(end + 1, NULL, 10);
+			have_range = 1;
+		} else if ((value = http_header_value(line,
+						      "Transfer-Encoding"))) {
+			if (strncasecmp(value, "identity", 8)) {
+				printf("Unsupported transfer encoding %s\n",
+				       value);
+				return -1;
+			}
+		}
+	}
+
+	if (!have_length) {
+		printf("HTTP response has no Content-Length.\n");
+		return -1;
+	}
+
+	uint32_t total = length;
+	if (code == 206) {
+		if (!have_range || range_start != http_offset ||
+		    range_total != http_offset + length) {
+			printf("HTTP server returned the wrong range.\n");
+			return -1;
+		}
+		total = range_total;
+	}
+
+	if (http_have_size && total != http_total_size) {
+		printf("HTTP file changed size while resuming.\n");
+		return -1;
+	}
+	if (total > http_max_size) {
+		printf("HTTP file too large (%u bytes).\n", total);
+		return -1;
+	}
+
+	http_total_size = total;
+	http_have_size = 1;
+	return 0;
+}
+
+// Copy body data straight into the destination buffer.
+static void http_recv_body(const uint8_t *data, uint32_t len)
+{
+	if (len > http_total_size - http_offset) {
+		printf("HTTP server sent more than Content-Length.\n");
+		http_status = HttpFailure;
+		uip_abort();
+		return;
+	}
+
+	uint32_t mb_before = http_offset >> 20;
+	memcpy(http_dest + http_offset, data, len);
+	http_offset += len;
+
+	// Give some feedback that something is happening.
+	if ((http_offset >> 20) != mb_before)
+		printf("#");
+
+	if (http_offset == http_total_size) {
+		http_status = HttpSuccess;
+		uip_close();
+	}
+}
+
+static void http_recv(void)
+{
+	uint8_t *data = uip_appdata;
+	uint32_t len = uip_datalen();
+
+	if (http_in_body) {
+		http_recv_body(data, len);
+		return;
+	}
+
+	// Accumulate the header until we see the blank line ending it.
+	uint32_t room = sizeof(http_header) - 1 - http_header_len;
+	uint32_t copy = MIN(len, room);
+	memcpy(http_header + http_header_len, data, copy);
+	http_header[http_header_len + copy] = '\0';
+
+	char *end = strstr(http_header, "\r\n\r\n");
+	if (!end) {
+		if (copy == room) {
+			printf("HTTP response header too large.\n");
+			http_status = HttpFailure;
+			uip_abort();
+			return;
+		}
+		http_header_len += copy;
+		return;
+	}
+
+	// Terminate after the last header line's CRLF.
+	uint32_t header_size = end + 4 - http_header;
+	end[2] = '\0';
+	uint32_t body_start = header_size - http_header_len;
+	http_header_len = header_size;
+
+	if (http_parse_header()) {
+		http_status = HttpFailure;
+		uip_abort();
+		return;
+	}
+	http_in_body = 1;
+
+	if (http_offset == http_total_size) {
+		http_status = HttpSuccess;
+		uip_close();
+		return;
+	}
+	if (len > body_start)
+		http_recv_body(data + body_start, len - body_start);
+}
+
+static void http_callback(void)
+{
+	// Ignore UDP traffic and other TCP connections.
+	if (uip_udpconnection() || uip_conn != http_conn)
+		return;
+
+	if (http_abort_requested) {
+		uip_abort();
+		return;
+	}
+
+	if (uip_connected() || uip_rexmit()) {
+		uip_send(http_request, http_request_len);
+		http_got_response = 1;
+	}
+
+	if (uip_newdata() && http_status == HttpPending) {
+		http_recv();
+		http_got_response = 1;
+	}
+
+	if (uip_closed() || uip_aborted() || uip_timedout()) {
+		if (http_status == HttpPending)
+			http_status = HttpConnectionLost;
+		http_conn = NULL;
+	}
+}
+
+// Split "http://host[:port]/path" into its parts.
+static int http_parse_url(const char *url, uip_ipaddr_t *server_ip,
+			  uip_ipaddr_t *ip, uint16_t *port, const char **path,
+			  char *host, int host_size)
+{
+	const char *start = url + sizeof(HttpScheme) - 1;
+	const char *slash = strchr(start, '/');
+	const char *host_end = slash ? slash : start + strlen(start);
+	const char *colon = memchr(start, ':', host_end - start);
+	const char *ip_end = colon ? colon : host_end;
+
+	*path = slash ? slash : "/";
+	*port = HttpPort;
+	if (colon) {
+		char *port_end;
+		unsigned long value = strtoul(colon + 1, &port_end, 10);
+		if (!isdigit(colon[1]) || port_end != host_end ||
+		    value == 0 || value > 0xffff) {
+			printf("Bad HTTP port in %s\n", url);
+			return -1;
+		}
+		*port = value;
+	}
+
+	if (host_end - start >= host_size) {
+		printf("HTTP host name too long.\n");
+		return -1;
+	}
+	memcpy(host, start, host_end - start);
+	host[host_end - start] = '\0';
+
+	if (ip_end == start) {
+		if (!server_ip) {
+			printf("No HTTP server IP in %s\n", url);
+			return -1;
+		}
+		*ip = *server_ip;
+		return 0;
+	}
+
+	char ip_str[16];
+	if ((size_t)(ip_end - start) >= sizeof(ip_str)) {
+		printf("HTTP host must be an IP address: %s\n", url);
+		return -1;
+	}
+	memcpy(ip_str, start, ip_end - start);
+	ip_str[ip_end - start] = '\0';
+	if (!uiplib_ipaddrconv(ip_str, ip)) {
+		printf("HTTP host must be an IP address: %s\n", url);
+		return -1;
+	}
+	return 0;
+}
+
+int http_read(void *dest, uip_ipaddr_t *server_ip, const char *url,
+	      uint32_t *size, uint32_t max_size)
+{
+	uip_ipaddr_t ip;
+	uint16_t port;
+	const char *path;
+	char host[64];
+
+	if (http_parse_url(url, server_ip, &ip, &port, &path, host,
+			   sizeof(host)))
+		return -1;
+
+	http_dest = dest;
+	http_max_size = max_size;
+	http_offset = 0;
+	http_total_size = 0;
+	http_have_size = 0;
+	http_status = HttpConnectionLost;
+
+	net_set_callback(&http_callback);
+
+	for (int attempt = 0; attempt <= HttpMaxRetries &&
+	     http_status == HttpConnectionLost; attempt++) {
+		// If we lost the connection part way through, only ask for
+		// what's left.
+		if (http_offset) {
+			printf("\nResuming HTTP transfer at %u bytes... ",
+			       http_offset);
+			http_request_len = snprintf(http_request,
+				sizeof(http_request),
+				"GET %s HTTP/1.1\r\nHost: %s\r\n"
+				"Connection: close\r\n"
+				"Range: bytes=%u-\r\n\r\n",
+				path, host, http_offset);
+		} else {
+			printf("Sending HTTP request... ");
+			http_request_len = snprintf(http_request,
+				sizeof(http_request),
+				"GET %s HTTP/1.1\r\nHost: %s\r\n"
+				"Connection: close\r\n\r\n",
+				path, host);
+		}
+		if (http_request_len >= sizeof(http_request)) {
+			printf("HTTP request too long.\n");
+			http_status = HttpFailure;
+			break;
+		}
+
+		http_conn = uip_connect(&ip, htonw(port));
+		if (!http_conn) {
+			printf("Failed to set up TCP connection.\n");
+			http_status = HttpFailure;
+			break;
+		}
+
+		http_status = HttpPending;
+		http_header_len = 0;
+		http_in_body = 0;
+		http_abort_requested = 0;
+
+		// Send the SYN right away rather than at the first tick.
+		uip_poll_conn(http_conn);
+		http_send_packet();
+
+		uint64_t periodic_timer = timer_us(0);
+		uint64_t idle_timer = timer_us(0);
+		while (http_status == HttpPending) {
+			http_got_response = 0;
+			net_poll_all();
+			if (http_got_response)
+				idle_timer = timer_us(0);
+
+			if (timer_us(idle_timer) > HttpIdleTimeoutUs) {
+				printf("HTTP server stopped responding.\n");
+				http_abort_requested = 1;
+				uip_poll_conn(http_conn);
+				http_send_packet();
+				http_status = HttpConnectionLost;
+				break;
+			}
+
+			if (timer_us(periodic_timer) < HttpPeriodicUs)
+				continue;
+			uip_periodic_conn(http_conn);
+			http_send_packet();
+			periodic_timer = timer_us(0);
+		}
+
+		// Let the FIN/RST we just queued go out.
+		if (http_conn) {
+			uip_periodic_conn(http_conn);
+			http_send_packet();
+		}
+	}
+
+	net_set_callback(NULL);
+
+	if (http_status != HttpSuccess) {
+		printf("HTTP transfer failed.\n");
+		return -1;
+	}
+
+	if (size)
+		*size = http_offset;
+	printf(" done.\n");
+	return 0;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * See file CREDITS for list of people who contributed to this
+ * project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but without any warranty; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __NETBOOT_HTTP_H__
+#define __NETBOOT_HTTP_H__
+
+#include <stdint.h>
+
+#include "net/uip.h"
+
+static const uint16_t HttpPort = 80;
+
+/* Returns whether a boot file name should be fetched with http_read(). */
+int http_is_url(const char *name);
+
+/*
+ * Fetch an "http://host[:port]/path" URL into dest. The host must be a
+ * dotted quad IP address; if it is empty, server_ip is used instead.
+ */
+int http_read(void *dest, uip_ipaddr_t *server_ip, const char *url,
+	      uint32_t *size, uint32_t max_size);
+
+#endif /* __NETBOOT_HTTP_H__ */
@@ -30,6 +30,7 @@
 #include "net/uip.h"
 #include "net/uip_arp.h"
 #include "netboot/dhcp.h"
+#include "netboot/http.h"
 #include "netboot/netboot.h"
 #include "netboot/params.h"
 #include "netboot/tftp.h"
@@ -70,10 +71,38 @@ static const uint32_t MaxPayloadSize = CONFIG_KERNEL_SIZE;
 static char cmd_line[4096] = "lsm.module_locking=0 cros_netboot_ramfs "
 			     "cros_factory_install cros_secure cros_netboot";
 
+// Fetch a file over HTTP if it's named by an http:// URL, otherwise TFTP.
+static int netboot_read(void *dest, uip_ipaddr_t *server_ip,
+			const char *name, uint32_t *size, uint32_t max_size)
+{
+	if (http_is_url(name))
+		return http_read(dest, server_ip, name, size, max_size);
+	return tftp_read(dest, server_ip, name, size, max_size);
+}
+
+// Get the lease saved by the last netboot, which lets DHCP skip discovery.
+// Returns NULL if leases aren't being cached at all.
+static DhcpLease *netboot_load_lease(DhcpLease *lease)
+{
+	if (!CONFIG(NETBOOT_DHCP_LEASE_CACHE))
+		return NULL;
+
+	if (netboot_lease_read(lease))
+		memset(lease, 0, sizeof(*lease));
+	return lease;
+}
+
+static void netboot_save_lease(const DhcpLease *lease)
+{
+	if (netboot_lease_write(lease))
+		printf("Failed to save DHCP lease.\n");
+}
+
 int try_dhcp(uip_ipaddr_t *my_ip,
 	     uip_ipaddr_t *next_ip,
 	     uip_ipaddr_t *server_ip,
-	     const char **dhcp_bootfile)
+	     const char **dhcp_bootfile,
+	     DhcpLease *lease)
 {
 	static int mac_addr_set = 0;
 
@@ -88,7 +117,7 @@ int try_dhcp(uip_ipaddr_t *my_ip,
 		uip_setethaddr(*mac_addr);
 	}
 
-	if (dhcp_request(next_ip, server_ip, dhcp_bootfile))
+	if (dhcp_request(next_ip, server_ip, dhcp_bootfile, lease))
 		return 1;
 
 	printf("My ip is ");
@@ -111,8 +140,13 @@ void netboot(uip_ipaddr_t *tftp_ip, char *bootfile, char *argsfile, char *args,
 	// Find out who we are.
 	uip_ipaddr_t my_ip, next_ip, server_ip;
 	const char *dhcp_bootfile;
-	while (try_dhcp(&my_ip, &next_ip, &server_ip, &dhcp_bootfile))
+	DhcpLease lease;
+	DhcpLease *cached_lease = netboot_load_lease(&lease);
+	while (try_dhcp(&my_ip, &next_ip, &server_ip, &dhcp_bootfile,
+			cached_lease))
 		printf("Dhcp failed, retrying.\n");
+	if (cached_lease)
+		netboot_save_lease(&lease);
 
 	if (!tftp_ip) {
 		tftp_ip = &next_ip;
@@ -132,8 +166,8 @@ void netboot(uip_ipaddr_t *tftp_ip, char *bootfile, char *argsfile, char *args,
 		printf("Bootfile predefined by user: %s\n", bootfile);
 	}
 
-	if (tftp_read(payload, tftp_ip, bootfile, &size, MaxPayloadSize)) {
-		printf("Tftp failed.\n");
+	if (netboot_read(payload, tftp_ip, bootfile, &size, MaxPayloadSize)) {
+		printf("Download failed.\n");
 		if (dhcp_release(server_ip))
 			printf("Dhcp release failed.\n");
 		halt();
@@ -151,17 +185,17 @@ void netboot(uip_ipaddr_t *tftp_ip, char *bootfile, char *argsfile, char *args,
 		if (size >= MaxPayloadSize) {
 			printf("No space left for ramdisk\n");
 			ramdisk = NULL;
-		} else if (tftp_read(ramdisk, tftp_ip, ramdiskfile,
-				     &ramdisk_size, MaxPayloadSize - size)) {
-			printf("TFTP failed for ramdisk.\n");
+		} else if (netboot_read(ramdisk, tftp_ip, ramdiskfile,
+					&ramdisk_size, MaxPayloadSize - size)) {
+			printf("Download failed for ramdisk.\n");
 			ramdisk = NULL;
 			ramdisk_size = 0;
 		}
 
 	}
 
-	// Try to download command line file via TFTP if argsfile is specified
-	if (argsfile && !(tftp_read(cmd_line, tftp_ip, argsfile, &size,
+	// Try to download command line file if argsfile is specified
+	if (argsfile && !(netboot_read(cmd_line, tftp_ip, argsfile, &size,
 			sizeof(cmd_line) - 1))) {
 		while (cmd_line[size - 1] <= ' ')  // strip trailing whitespace
 			if (!--size) break;	   // and control chars (\n, \r)
@@ -169,7 +203,7 @@ void netboot(uip_ipaddr_t *tftp_ip, char *bootfile, char *argsfile, char *args,
 		while (size--)			   // replace inline control
 			if (cmd_line[size] < ' ')  // chars with spaces
 				cmd_line[size] = ' ';
-		printf("Command line loaded dynamically from TFTP file: %s\n",
+		printf("Command line loaded dynamically from file: %s\n",
 				argsfile);
 	// If that fails or file wasn't specified fall back to args parameter
 	} else if (args) {
@@ -16,14 +16,17 @@
 #define __NETBOOT_NETBOOT_H__
 
 #include "net/uip.h"
+#include "netboot/dhcp.h"
 
 /* argsfile takes precedence before args. All parameters can be NULL. */
 void netboot(uip_ipaddr_t *tftp_ip, char *bootfile, char *argsfile, char *args,
 	     char *ramdiskfile);
 int netboot_entry(void);
+/* lease can be NULL, otherwise see dhcp_request(). */
 int try_dhcp(uip_ipaddr_t *my_ip,
 	     uip_ipaddr_t *next_ip,
 	     uip_ipaddr_t *server_ip,
-	     const char **dhcp_bootfile);
+	     const char **dhcp_bootfile,
+	     DhcpLease *lease);
 
 #endif /* __NETBOOT_NETBOOT_H__ */
@@ -25,9 +25,23 @@
 #include "netboot/params.h"
 
 static NetbootParam netboot_params[NetbootParamIdMax];
+// How much of the data netboot_params_init() parsed the parameters take up.
+static uintptr_t netboot_params_used;
 
 const char netboot_sig[] = "netboot";
 
+// The DHCP lease lives in a record of its own at the very end of SHARED_DATA,
+// not in the parameter list. Images from before the lease cache index
+// netboot_params[] with any id they find in the list, so it must only ever
+// hold the ids they know.
+typedef struct __attribute__((packed)) NetbootLease
+{
+	char sig[8];
+	DhcpLease lease;
+} NetbootLease;
+
+static const char netboot_lease_sig[8] = "dhcplse";
+
 NetbootParam *netboot_params_val(NetbootParamId param)
 {
 	assert(param < NetbootParamIdMax);
@@ -44,6 +58,7 @@ int netboot_params_init(void *data, uintptr_t size)
 	assert(data);
 
 	memset(netboot_params, 0, sizeof(netboot_params));
+	netboot_params_used = 0;
 
 	if (size < sizeof(netboot_sig))
 		return 1;
@@ -72,10 +87,15 @@ int netboot_params_init(void *data, uintptr_t size)
 		if (pos >= max_pos)
 			return 1;
 
+		// Skip parameters this image doesn't know about.
+		if (val_type >= NetbootParamIdMax)
+			continue;
+
 		NetbootParam *param = &netboot_params[val_type];
 		param->data = val_data;
 		param->size = val_size;
 	}
+	netboot_params_used = pos * sizeof(uint32_t);
 	return 0;
 }
 
@@ -133,3 +153,62 @@ int netboot_params_read(uip_ipaddr_t **tftp_ip, char *cmd_line,
 
 	return 0;
 }
+
+// Where the lease goes, and how much of SHARED_DATA comes before it.
+static int netboot_lease_offset(uint32_t *offset, uint32_t *before)
+{
+	FmapArea shared_data;
+	if (fmap_find_area("SHARED_DATA", &shared_data)) {
+		printf("Couldn't find the shared data area.\n");
+		return 1;
+	}
+	if (shared_data.size < sizeof(NetbootLease))
+		return 1;
+
+	*before = shared_data.size - sizeof(NetbootLease);
+	*offset = shared_data.offset + *before;
+	return 0;
+}
+
+int netboot_lease_read(DhcpLease *lease)
+{
+	NetbootLease record;
+	uint32_t offset, before;
+
+	if (netboot_lease_offset(&offset, &before) ||
+	    flash_read(&record, offset, sizeof(record)) != sizeof(record) ||
+	    memcmp(record.sig, netboot_lease_sig, sizeof(record.sig)))
+		return 1;
+
+	memcpy(lease, &record.lease, sizeof(*lease));
+	return 0;
+}
+
+int netboot_lease_write(const DhcpLease *lease)
+{
+	NetbootLease record;
+	uint32_t offset, before;
+
+	if (netboot_lease_offset(&offset, &before))
+		return 1;
+
+	// Only write to a SHARED_DATA that holds netboot parameters, and
+	// never over them.
+	if (!netboot_params_used || netboot_params_used > before) {
+		printf("No room for the DHCP lease.\n");
+		return 1;
+	}
+
+	// Don't wear out the flash rewriting the same lease every boot.
+	if (flash_read(&record, offset, sizeof(record)) == sizeof(record) &&
+	    !memcmp(record.sig, netboot_lease_sig, sizeof(record.sig)) &&
+	    !memcmp(&record.lease, lease, sizeof(*lease)))
+		return 0;
+
+	printf("Saving DHCP lease.\n");
+	memcpy(record.sig, netboot_lease_sig, sizeof(record.sig));
+	memcpy(&record.lease, lease, sizeof(*lease));
+	if (flash_rewrite(&record, offset, sizeof(record)) != sizeof(record))
+		return 1;
+	return 0;
+}
@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 #include "net/uip.h"
+#include "netboot/dhcp.h"
 
 typedef enum NetbootParamId
 {
@@ -42,5 +43,8 @@ int netboot_params_init(void *data, uintptr_t size);
 int netboot_params_read(uip_ipaddr_t **tftp_ip, char *cmd_line,
 			size_t cmd_line_max, char **bootfile, char **argsfile);
 NetbootParam *netboot_params_val(NetbootParamId paramId);
+// The DHCP lease saved by the last netboot, kept apart from the parameters.
+int netboot_lease_read(DhcpLease *lease);
+int netboot_lease_write(const DhcpLease *lease);
 
 #endif /* __NETBOOT_PARAMS_H__ */
@@ -44,6 +44,18 @@ static int tftp_blocknum;
 static uint32_t tftp_total_size;
 static uint32_t tftp_max_size;
 
+// Whether the server has answered the read request, with an OACK or data.
+static int tftp_started;
+// Whether the server rejected the options and the request must be resent.
+static int tftp_options_refused;
+// Negotiated transfer parameters.
+static int tftp_block_size;
+static int tftp_window_size;
+// Number of blocks received in the current window.
+static int tftp_window_count;
+// Whether we've already asked the server to restart the current window.
+static int tftp_window_restarted;
+
 typedef struct TftpAckPacket
 {
 	uint16_t opcode;
@@ -99,6 +111,70 @@ static void tftp_print_error_pkt(void)
 	}
 }
 
+static void tftp_send_ack(int blocknum)
+{
+	TftpAckPacket ack = {
+		htonw(TftpAck),
+		htonw(blocknum)
+	};
+	memcpy(uip_appdata, &ack, sizeof(ack));
+	uip_udp_send(sizeof(ack));
+}
+
+static void tftp_send_error(TftpErrorCode code, const char *message)
+{
+	uint16_t header[2] = { htonw(TftpError), htonw(code) };
+	int message_len = strlen(message) + 1;
+
+	memcpy(uip_appdata, header, sizeof(header));
+	memcpy((uint8_t *)uip_appdata + sizeof(header), message, message_len);
+	uip_udp_send(sizeof(header) + message_len);
+}
+
+// Parse an OACK packet. Returns 0 if the transfer can proceed.
+static int tftp_handle_oack(void)
+{
+	const char *opts = (const char *)uip_appdata + 2;
+	int remaining = uip_datalen() - 2;
+
+	while (remaining > 0) {
+		int name_len = strnlen(opts, remaining) + 1;
+		if (name_len >= remaining)
+			break;
+		const char *value = opts + name_len;
+		int value_len = strnlen(value, remaining - name_len) + 1;
+		if (name_len + value_len > remaining)
+			break;
+
+		uint32_t val = strtoul(value, NULL, 10);
+		if (!strcasecmp(opts, "blksize")) {
+			if (val < 8 || val > TftpMaxBlockSize) {
+				printf("Bad blksize %u in OACK.\n", val);
+				return -1;
+			}
+			tftp_block_size = val;
+		} else if (!strcasecmp(opts, "windowsize")) {
+			if (val < 1 || val > TftpMaxWindowSize) {
+				printf("Bad windowsize %u in OACK.\n", val);
+				return -1;
+			}
+			tftp_window_size = val;
+		} else if (!strcasecmp(opts, "tsize")) {
+			if (val > tftp_max_size) {
+				printf("TFTP file too large (%u bytes).\n",
+				       val);
+				tftp_send_error(TftpNoSpace, "File too large");
+				return -1;
+			}
+		}
+
+		opts += name_len + value_len;
+		remaining -= name_len + value_len;
+	}
+
+	return 0;
+}
+
 static void tftp_callback(void)
 {
 	// If there isn't at least an opcode, ignore the packet.
@@ -121,31 +197,76 @@ static void tftp_callback(void)
 
 	// If there was an error, report it and stop the transfer.
 	if (opcode == TftpError) {
+		uint16_t error = 0;
+		if (uip_datalen() >= 4) {
+			memcpy(&error, (uint8_t *)uip_appdata + 2,
+			       sizeof(error));
+			error = ntohw(error);
+		}
+		// Servers which don't like our options may refuse them
+		// outright, in which case we retry with a plain request.
+		if (!tftp_started && error == TftpOptionRefused) {
+			tftp_options_refused = 1;
+			tftp_status = TftpFailure;
+			return;
+		}
 		tftp_status = TftpFailure;
 		printf(" error!\n");
 		tftp_print_error_pkt();
 		return;
 	}
 
-	// We should only get data packets. Those are at least 4 bytes long.
+	// The server accepted (some of) our options. Acknowledge with block
+	// 0 to start the transfer.
+	if (opcode == TftpOptionAck) {
+		if (tftp_started)
+			return;
+		if (tftp_handle_oack()) {
+			tftp_status = TftpFailure;
+			return;
+		}
+		tftp_started = 1;
+		tftp_send_ack(0);
+		tftp_got_response = 1;
+		return;
+	}
+
+	// Otherwise we should only get data packets. Those are at least 4
+	// bytes long.
 	if (opcode != TftpData || uip_datalen() < 4)
 		return;
 
+	// A server which ignores options goes straight to sending data,
+	// which means the defaults apply.
+	if (!tftp_started) {
+		tftp_started = 1;
+		tftp_block_size = TftpDefaultBlockSize;
+		tftp_window_size = 1;
+	}
+
 	// Get the block number.
 	uint16_t blocknum;
 	memcpy(&blocknum, (uint8_t *)uip_appdata + 2, sizeof(blocknum));
 	blocknum = ntohw(blocknum);
 
-	// Ignore blocks which are duplicated or out of order, taking into
-	// account 16-bit block number overflow.
-	if (blocknum != (tftp_blocknum & 0xFFFF))
+	// Ignore blocks which are duplicated, taking into account 16-bit
+	// block number overflow. If a block is missing from the middle of a
+	// window, ack the last one we got so the server restarts from there.
+	uint16_t ahead = blocknum - (uint16_t)tftp_blocknum;
+	if (ahead) {
+		if (ahead < 0x8000 && !tftp_window_restarted) {
+			tftp_send_ack(tftp_blocknum - 1);
+			tftp_window_restarted = 1;
+			tftp_window_count = 0;
+		}
 		return;
+	}
 
 	void *new_data = (uint8_t *)uip_appdata + 4;
 	int new_data_len = uip_datalen() - 4;
 
 	// If the block is too big, reject it.
-	if (new_data_len > TftpMaxBlockSize)
+	if (new_data_len > tftp_block_size)
 		return;
 
 	// If we're out of space give up.
@@ -162,21 +283,20 @@ static void tftp_callback(void)
 	}
 	tftp_total_size += new_data_len;
 
-	// Prepare an ack.
-	TftpAckPacket ack = {
-		htonw(TftpAck),
-		htonw(tftp_blocknum)
-	};
-	memcpy(uip_appdata, &ack, sizeof(ack));
-	uip_udp_send(sizeof(ack));
-
 	tftp_got_response = 1;
+	tftp_window_restarted = 0;
 
-	// If this block was less than the maximum size, the transfer is done.
-	if (new_data_len < TftpMaxBlockSize) {
+	// If this block was less than the maximum size, the transfer is
+	// done. Otherwise only ack once a full window has arrived.
+	if (new_data_len < tftp_block_size) {
+		tftp_send_ack(tftp_blocknum);
 		tftp_status = TftpSuccess;
 		return;
 	}
+	if (++tftp_window_count >= tftp_window_size) {
+		tftp_send_ack(tftp_blocknum);
+		tftp_window_count = 0;
+	}
 
 	// Move on to the next block.
 	tftp_blocknum++;
@@ -187,24 +307,51 @@ static void tftp_callback(void)
 	}
 }
 
-int tftp_read(void *dest, uip_ipaddr_t *server_ip, const char *bootfile,
-	uint32_t *size, uint32_t max_size)
+static uint8_t *tftp_build_request(const char *bootfile, int with_options,
+				   int *len)
 {
-	// Build the read request packet.
+	const char mode[] = "Octet";
+	char options[64];
+	int options_len = 0;
+
+	if (with_options) {
+		// Each option is a NUL terminated name followed by a NUL
+		// terminated value. Ask for a tsize of 0 to have the server
+		// tell us the size of the file.
+		options_len = snprintf(options, sizeof(options),
+				       "blksize%c%d%cwindowsize%c%d%ctsize%c0",
+				       0, TftpMaxBlockSize, 0, 0,
+				       TftpMaxWindowSize, 0, 0) + 1;
+	}
+
 	uint16_t opcode = htonw(TftpReadReq);
 	int opcode_len = sizeof(opcode);
-
 	int name_len = strlen(bootfile) + 1;
-
-	const char mode[] = "Octet";
 	int mode_len = sizeof(mode);
 
-	int read_req_len = opcode_len + name_len + mode_len;
-	uint8_t *read_req = xmalloc(read_req_len);
+	*len = opcode_len + name_len + mode_len + options_len;
+	uint8_t *read_req = xmalloc(*len);
+
+	uint8_t *ptr = read_req;
+	memcpy(ptr, &opcode, opcode_len);
+	ptr += opcode_len;
+	memcpy(ptr, bootfile, name_len);
+	ptr += name_len;
+	memcpy(ptr, mode, mode_len);
+	ptr += mode_len;
+	memcpy(ptr, options, options_len);
+
+	return read_req;
+}
 
-	memcpy(read_req, &opcode, opcode_len);
-	memcpy(read_req + opcode_len, bootfile, name_len);
-	memcpy(read_req + opcode_len + name_len, mode, mode_len);
+static int tftp_transfer(void *dest, uip_ipaddr_t *server_ip,
+			 const char *bootfile, uint32_t max_size,
+			 int with_options)
+{
+	// Build the read request packet.
+	int read_req_len;
+	uint8_t *read_req = tftp_build_request(bootfile, with_options,
+					       &read_req_len);
 
 	// Set up the UDP connection.
 	struct uip_udp_conn *conn = uip_udp_new(server_ip, htonw(TftpPort));
@@ -227,6 +374,12 @@ int tftp_read(void *dest, uip_ipaddr_t *server_ip, const char *bootfile,
 	tftp_blocknum = 1;
 	tftp_total_size = 0;
 	tftp_max_size = max_size;
+	tftp_started = 0;
+	tftp_options_refused = 0;
+	tftp_block_size = TftpDefaultBlockSize;
+	tftp_window_size = 1;
+	tftp_window_count = 0;
+	tftp_window_restarted = 0;
 
 	// Poll the network driver until the transaction is done.
 
@@ -234,26 +387,30 @@ int tftp_read(void *dest, uip_ipaddr_t *server_ip, const char *bootfile,
 	uint64_t resend_timer = timer_us(0);
 	while (tftp_status == TftpPending) {
 		tftp_got_response = 0;
-		net_poll();
-		if (tftp_got_response)
+		net_poll_all();
+		if (tftp_got_response) {
+			resend_timer = timer_us(0);
 			continue;
+		}
 
 		if (timer_us(resend_timer) < TfTpRespTimeoutUs)
 			continue;
 
 		// No response. Resend our last packet and try again.
-		if (tftp_blocknum == 1) {
+		if (!tftp_started) {
 			// Resend the read request.
 			conn->rport = htonw(TftpPort);
 			uip_udp_packet_send(conn, read_req, read_req_len);
 			conn->rport = 0;
 		} else {
-			// Resend the last ack.
+			// Ack the last block we got, which restarts the
+			// window from the block after it.
 			TftpAckPacket ack = {
 				htonw(TftpAck),
 				htonw(tftp_blocknum - 1)
 			};
 			uip_udp_packet_send(conn, &ack, sizeof(ack));
+			tftp_window_count = 0;
 		}
 		resend_timer = timer_us(0);
 	}
@@ -261,8 +418,20 @@ int tftp_read(void *dest, uip_ipaddr_t *server_ip, const char *bootfile,
 	free(read_req);
 	net_set_callback(NULL);
 
+	return tftp_status == TftpSuccess ? 0 : -1;
+}
+
+int tftp_read(void *dest, uip_ipaddr_t *server_ip, const char *bootfile,
+	uint32_t *size, uint32_t max_size)
+{
+	int ret = tftp_transfer(dest, server_ip, bootfile, max_size, 1);
+	if (ret && tftp_options_refused) {
+		printf("Server refused options, retrying without them.\n");
+		ret = tftp_transfer(dest, server_ip, bootfile, max_size, 0);
+	}
+
 	// See what happened.
-	if (tftp_status == TftpFailure) {
+	if (ret) {
 		// The error was printed when it was received.
 		return -1;
 	} else {
@@ -26,7 +26,8 @@ typedef enum TftpOpcode
 	TftpWriteReq = 2,
 	TftpData = 3,
 	TftpAck = 4,
-	TftpError = 5
+	TftpError = 5,
+	TftpOptionAck = 6
 } TftpOpcode;
 
 typedef enum TftpErrorCode
@@ -38,11 +39,17 @@ typedef enum TftpErrorCode
 	TftpIllegalOp = 4,
 	TftpUnknownId = 5,
 	TftpFileExists = 6,
-	TftpNoSuchUser = 7
+	TftpNoSuchUser = 7,
+	TftpOptionRefused = 8
 } TftpErrorCode;
 
 static const uint16_t TftpPort = 69;
-static const int TftpMaxBlockSize = 512;
+// Block size used when the server doesn't acknowledge any options.
+static const int TftpDefaultBlockSize = 512;
+// Largest block which fits into a single frame without IP fragmentation.
+static const int TftpMaxBlockSize = CONFIG_UIP_LINK_MTU - 20 - 8 - 4;
+// Number of blocks the server may send before waiting for an ack.
+static const int TftpMaxWindowSize = 16;
 
 int tftp_read(void *dest, uip_ipaddr_t *server_ip, const char *bootfile,
 	uint32_t *size, uint32_t max_size);
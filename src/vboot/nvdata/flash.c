@@ -49,12 +49,32 @@ static int nvdata_blob_offset;
 /* Local cache of the nvdata blob. */
 static uint8_t nvdata_cache[VB2_NVDATA_SIZE];
 
+static int nvdata_flash_is_initialized;
+
+/*
+ * Return how many bytes at the start of the area are in use, that is the
+ * offset just past the last word which isn't erased.
+ */
+static uint32_t nvdata_used_size(const uint8_t *area, uint32_t size)
+{
+	const uint32_t *words = (const uint32_t *)area;
+	uint32_t used = size;
+
+	/* Check any bytes past the last whole word one at a time. */
+	while (used % sizeof(*words))
+		if (area[--used] != 0xff)
+			return used + 1;
+
+	while (used && words[used / sizeof(*words) - 1] == 0xffffffff)
+		used -= sizeof(*words);
+
+	return used;
+}
+
 static int flash_nvdata_init(void)
 {
-	int used_below, empty_above;
-	static int nvdata_flash_is_initialized = 0;
-	uint8_t empty_nvdata_block[sizeof(nvdata_cache)];
-	uint8_t block[sizeof(nvdata_cache)];
+	uint8_t *area;
+	uint32_t used;
 
 	if (nvdata_flash_is_initialized)
 		return 0;
@@ -64,42 +84,39 @@ static int flash_nvdata_init(void)
 		return -1;
 	}
 
-	/* Prepare an empty nvdata block to compare against. */
-	memset(empty_nvdata_block, 0xff, sizeof(empty_nvdata_block));
-
-	/* Binary search for the border between used and empty */
-	used_below = 0;
-	empty_above = nvdata_area_descriptor.size / sizeof(nvdata_cache);
-
-	while (used_below + 1 < empty_above) {
-		int guess = (used_below + empty_above) / 2;
-		if (flash_read(block,
-			       nvdata_area_descriptor.offset +
-				       guess * sizeof(nvdata_cache),
-			       sizeof(nvdata_cache)) != sizeof(nvdata_cache)) {
-			printf("%s: failed to read nvdata area\n", __func__);
-			return -1;
-		}
-
-		if (!memcmp(block, empty_nvdata_block, sizeof(nvdata_cache)))
-			empty_above = guess;
-		else
-			used_below = guess;
+	if (nvdata_area_descriptor.size < sizeof(nvdata_cache)) {
+		printf("%s: nvdata area is too small\n", __func__);
+		return -1;
 	}
 
 	/*
-	 * Offset points to the last non-empty blob.  Or if all blobs are empty
-	 * (nvdata is totally erased), point to the first blob.
+	 * The area is only a few KiB, so fetch all of it at once rather than
+	 * doing a flash transaction for every blob we look at.
 	 */
-	nvdata_blob_offset = used_below * sizeof(nvdata_cache);
-
-	if (flash_read(block,
-		       nvdata_area_descriptor.offset + nvdata_blob_offset,
-		       sizeof(nvdata_cache)) != sizeof(nvdata_cache)) {
+	area = xmalloc(nvdata_area_descriptor.size);
+	if (flash_read(area, nvdata_area_descriptor.offset,
+		       nvdata_area_descriptor.size) !=
+	    nvdata_area_descriptor.size) {
 		printf("%s: failed to read nvdata area\n", __func__);
+		free(area);
 		return -1;
 	}
-	memcpy(nvdata_cache, block, sizeof(nvdata_cache));
+
+	/*
+	 * Offset points to the last non-empty blob.  Or if all blobs are empty
+	 * (nvdata is totally erased), point to the first blob. Everything
+	 * past it is erased, so new blobs can be appended without an erase.
+	 */
+	used = nvdata_used_size(area, nvdata_area_descriptor.size);
+	if (used)
+		used--;
+	nvdata_blob_offset = ALIGN_DOWN(used, sizeof(nvdata_cache));
+	if (nvdata_blob_offset + sizeof(nvdata_cache) >
+	    nvdata_area_descriptor.size)
+		nvdata_blob_offset -= sizeof(nvdata_cache);
+
+	memcpy(nvdata_cache, area + nvdata_blob_offset, sizeof(nvdata_cache));
+	free(area);
 
 	nvdata_flash_is_initialized = 1;
 	return 0;
@@ -147,10 +164,12 @@ vb2_error_t nvdata_flash_write(const uint8_t *buf)
 		int new_blob_offset;
 		/*
 		 * Won't be able to overwrite, need to use the next blob,
-		 * let's see if it is available.
+		 * let's see if it is available. Everything past the current
+		 * blob is erased, so only erase once the area is used up.
 		 */
 		new_blob_offset = nvdata_blob_offset + sizeof(nvdata_cache);
-		if (new_blob_offset >= nvdata_area_descriptor.size) {
+		if (new_blob_offset + sizeof(nvdata_cache) >
+		    nvdata_area_descriptor.size) {
 			printf("nvdata block is used up. "
 			       "deleting it to start over\n");
 			if (erase_nvdata())
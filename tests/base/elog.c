@@ -8,6 +8,8 @@
 
 #include "base/elog.c"
 
+struct list_node cleanup_funcs;
+
 /* Fixed value for ignoring some checks. */
 #define MOCK_IGNORE 0xffffu
 
@@ -383,6 +385,7 @@ static void test_elog_add_event(void **state)
 	assert_int_equal(elog_state.elog_initialized, ELOG_INIT_INITIALIZED);
 	assert_int_equal(elog_add_event_raw(0xb, NULL, 0), ELOG_SUCCESS);
 	assert_int_equal(elog_add_event_raw(0xc, NULL, 0), ELOG_SUCCESS);
+	assert_int_equal(elog_flush(), ELOG_SUCCESS);
 	assert_memory_equal(elog_state.data, mock_flash_buf, ELOG_SIZE);
 	/* Verify events */
 	EXPECT_ELOG_EVENT(0xa, BASE_EVENT_SIZE);
@@ -409,6 +412,7 @@ static void test_elog_add_event_data(void **state)
 	assert_int_equal(elog_state.elog_initialized, ELOG_INIT_INITIALIZED);
 	assert_int_equal(elog_add_event_raw(0xb, data, 3), ELOG_SUCCESS);
 	assert_int_equal(elog_add_event_raw(0xc, data, 4), ELOG_SUCCESS);
+	assert_int_equal(elog_flush(), ELOG_SUCCESS);
 	assert_memory_equal(elog_state.data, mock_flash_buf, ELOG_SIZE);
 	/* Verify events */
 	EXPECT_ELOG_EVENT(0xa, BASE_EVENT_SIZE);
@@ -417,6 +421,56 @@ static void test_elog_add_event_data(void **state)
 	verify_elog_events(rw_elog_mirror_buf);
 }
 
+/* Events wait in memory until the cleanup function runs */
+static void test_elog_add_event_write_back(void **state)
+{
+	uint8_t *flash = mock_flash_buf;
+
+	set_mock_fmap_area(&area_rw_elog, rw_elog_mirror_buf);
+	will_return(fmap_find_area, 0);
+	will_return_always(flash_read, MOCK_FLASH_SUCCESS);
+	will_return_always(flash_write, MOCK_FLASH_SUCCESS);
+	push_elog_event(0xa, NULL, 0);
+	expect_string(fmap_find_area, name, ELOG_RW_REGION_NAME);
+	assert_int_equal(elog_init(), ELOG_SUCCESS);
+	assert_int_equal(elog_add_event_raw(0xb, NULL, 0), ELOG_SUCCESS);
+	assert_int_equal(elog_add_event_raw(0xc, NULL, 0), ELOG_SUCCESS);
+	assert_int_equal(flash[rw_elog_mirror_offset], ELOG_TYPE_EOL);
+	assert_int_equal(elog_state.nv_last_write, rw_elog_mirror_offset);
+
+	assert_int_equal(elog_flush_cleanup(NULL, CleanupOnHandoff), 0);
+	assert_int_equal(elog_state.nv_last_write, elog_state.last_write);
+	assert_memory_equal(elog_state.data, mock_flash_buf, ELOG_SIZE);
+	EXPECT_ELOG_EVENT(0xa, BASE_EVENT_SIZE);
+	EXPECT_ELOG_EVENT(0xb, BASE_EVENT_SIZE);
+	EXPECT_ELOG_EVENT(0xc, BASE_EVENT_SIZE);
+	verify_elog_events(rw_elog_mirror_buf);
+}
+
+/* Enough pending events are written without waiting for the cleanup */
+static void test_elog_add_event_write_back_threshold(void **state)
+{
+	uint8_t data[MAX_DATA_SIZE] = {};
+	int count = 0;
+
+	set_mock_fmap_area(&area_rw_elog, rw_elog_mirror_buf);
+	will_return(fmap_find_area, 0);
+	will_return_always(flash_read, MOCK_FLASH_SUCCESS);
+	will_return_always(flash_write, MOCK_FLASH_SUCCESS);
+	expect_string(fmap_find_area, name, ELOG_RW_REGION_NAME);
+	assert_int_equal(elog_init(), ELOG_SUCCESS);
+
+	while (elog_state.nv_last_write == rw_elog_mirror_offset) {
+		assert_int_equal(elog_add_event_raw(0xb, data, sizeof(data)),
+				 ELOG_SUCCESS);
+		count++;
+	}
+	assert_int_equal(count, DIV_ROUND_UP(ELOG_WRITE_BACK_THRESHOLD,
+					     ELOG_MAX_EVENT_SIZE));
+	assert_int_equal(elog_state.nv_last_write, elog_state.last_write);
+	assert_memory_equal(elog_state.data, mock_flash_buf, ELOG_SIZE);
+}
+
 #define ELOG_TEST(test_function_name) \
 	cmocka_unit_test_setup(test_function_name, setup)
 
@@ -434,6 +488,8 @@ int main(void)
 		ELOG_TEST(test_elog_init_event_data_exceed_buffer),
 		ELOG_TEST(test_elog_add_event),
 		ELOG_TEST(test_elog_add_event_data),
+		ELOG_TEST(test_elog_add_event_write_back),
+		ELOG_TEST(test_elog_add_event_write_back_threshold),
 	};
 
 	return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <cbfs.h>
+#include <libpayload.h>
+
+#include "drivers/flash/cbfs.h"
+#include "tests/test.h"
+
+#include "drivers/flash/cbfs.c"
+
+#define FAKE_FLASH_SIZE 0x4000
+
+static uint8_t fake_flash[FAKE_FLASH_SIZE];
+/* Reads through the flash cache, and around it. */
+static int read_count;
+static int direct_read_count;
+
+/* Mocks */
+
+int flash_read(void *buffer, uint32_t offset, uint32_t size)
+{
+	assert_true(offset + size <= FAKE_FLASH_SIZE);
+	memcpy(buffer, fake_flash + offset, size);
+	read_count++;
+	return size;
+}
+
+int flash_read_direct(void *buffer, uint32_t offset, uint32_t size)
+{
+	assert_true(offset + size <= FAKE_FLASH_SIZE);
+	memcpy(buffer, fake_flash + offset, size);
+	direct_read_count++;
+	return size;
+}
+
+/* Helpers */
+
+static void read_and_check(size_t offset, size_t size)
+{
+	uint8_t buf[FAKE_FLASH_SIZE];
+
+	assert_int_equal(boot_device_read(buf, offset, size), size);
+	assert_memory_equal(buf, fake_flash + offset, size);
+}
+
+static int setup(void **state)
+{
+	for (int i = 0; i < FAKE_FLASH_SIZE; i++)
+		fake_flash[i] = i * 7;
+	cbfs_flash_invalidate(0, FAKE_FLASH_SIZE);
+	read_count = 0;
+	direct_read_count = 0;
+	return 0;
+}
+
+/* Test functions */
+
+static void test_metadata_read_once(void **state)
+{
+	/* Walk the same headers and names twice. */
+	for (int pass = 0; pass < 2; pass++) {
+		for (size_t offset = 0; offset < FAKE_FLASH_SIZE;
+		     offset += 0x200) {
+			read_and_check(offset, sizeof(struct cbfs_file));
+			read_and_check(offset + sizeof(struct cbfs_file), 40);
+		}
+	}
+	assert_int_equal(direct_read_count, 2 * FAKE_FLASH_SIZE / 0x200);
+	assert_int_equal(read_count, 0);
+}
+
+static void test_small_data_not_kept(void **state)
+{
+	/* Not a header, nor right after one. */
+	read_and_check(0x100, 16);
+	read_and_check(0x100, 16);
+	read_and_check(0x110, sizeof(struct cbfs_file));
+	read_and_check(0x110, sizeof(struct cbfs_file));
+	read_and_check(0x100 + sizeof(struct cbfs_file), 40);
+	assert_int_equal(read_count, 5);
+	assert_int_equal(direct_read_count, 0);
+}
+
+static void test_name_only_right_after_header(void **state)
+{
+	read_and_check(0x200, sizeof(struct cbfs_file));
+	read_and_check(0x400, 0x100);
+	read_and_check(0x200 + sizeof(struct cbfs_file), 40);
+	assert_int_equal(direct_read_count, 1);
+	assert_int_equal(read_count, 2);
+}
+
+static void test_different_size_not_cached(void **state)
+{
+	read_and_check(0x100, sizeof(struct cbfs_file));
+	read_and_check(0x100 + sizeof(struct cbfs_file), 16);
+	read_and_check(0x100, sizeof(struct cbfs_file));
+	read_and_check(0x100 + sizeof(struct cbfs_file), 40);
+	assert_int_equal(direct_read_count, 3);
+	read_and_check(0x100, sizeof(struct cbfs_file));
+	read_and_check(0x100 + sizeof(struct cbfs_file), 16);
+	assert_int_equal(direct_read_count, 3);
+}
+
+static void test_data_read_passes_through(void **state)
+{
+	size_t size = sizeof(union cbfs_mdata) + 1;
+
+	read_and_check(0x400, size);
+	read_and_check(0x400, size);
+	assert_int_equal(read_count, 2);
+	assert_int_equal(direct_read_count, 0);
+}
+
+static void test_invalidate(void **state)
+{
+	read_and_check(0x1000, sizeof(struct cbfs_file));
+	read_and_check(0x2000, sizeof(struct cbfs_file));
+	assert_int_equal(direct_read_count, 2);
+
+	/* Overwrite the first header. */
+	memset(fake_flash + 0x1000, 0xa5, sizeof(struct cbfs_file));
+	cbfs_flash_invalidate(0x1010, 0x100);
+	read_and_check(0x1000, sizeof(struct cbfs_file));
+	read_and_check(0x2000, sizeof(struct cbfs_file));
+	assert_int_equal(direct_read_count, 3);
+}
+
+#define CBFS_TEST(func) cmocka_unit_test_setup(func, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		CBFS_TEST(test_metadata_read_once),
+		CBFS_TEST(test_small_data_not_kept),
+		CBFS_TEST(test_name_only_right_after_header),
+		CBFS_TEST(test_different_size_not_cached),
+		CBFS_TEST(test_data_read_passes_through),
+		CBFS_TEST(test_invalidate),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
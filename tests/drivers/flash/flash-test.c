@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+#include <string.h>
+
+#include "drivers/flash/flash.h"
+#include "tests/test.h"
+
+#include "drivers/flash/flash.c"
+
+#define FAKE_FLASH_SIZE (64 * KiB)
+
+static uint8_t fake_flash[FAKE_FLASH_SIZE];
+static int fake_reads;
+static uint32_t fake_bytes_read;
+static int fake_writes;
+static uint32_t fake_bytes_written;
+static int fake_erases;
+static uint32_t fake_bytes_erased;
+
+static int fake_read(FlashOps *me, void *buffer, uint32_t offset,
+		     uint32_t size)
+{
+	if (offset >= FAKE_FLASH_SIZE)
+		return -1;
+	size = MIN(size, FAKE_FLASH_SIZE - offset);
+	memcpy(buffer, fake_flash + offset, size);
+	fake_reads++;
+	fake_bytes_read += size;
+	return size;
+}
+
+/* Like NOR flash, writes can only clear bits. */
+static int fake_write(FlashOps *me, const void *buffer, uint32_t offset,
+		      uint32_t size)
+{
+	const uint8_t *data = buffer;
+
+	for (uint32_t i = 0; i < size; i++)
+		fake_flash[offset + i] &= data[i];
+	fake_writes++;
+	fake_bytes_written += size;
+	return size;
+}
+
+static int fake_erase(FlashOps *me, uint32_t offset, uint32_t size)
+{
+	assert_int_equal(offset % me->sector_size, 0);
+	assert_int_equal(size % me->sector_size, 0);
+	memset(fake_flash + offset, 0xff, size);
+	fake_erases++;
+	fake_bytes_erased += size;
+	return size;
+}
+
+static FlashOps fake_ops = {
+	.read = fake_read,
+	.write = fake_write,
+	.erase = fake_erase,
+	.sector_size = 4 * KiB,
+	.sector_count = FAKE_FLASH_SIZE / (4 * KiB),
+	.program_without_erase = 1,
+};
+
+static int setup(void **state)
+{
+	for (int i = 0; i < FAKE_FLASH_SIZE; i++)
+		fake_flash[i] = i * 7 + (i >> 8);
+	fake_reads = 0;
+	fake_bytes_read = 0;
+	fake_writes = 0;
+	fake_bytes_written = 0;
+	fake_erases = 0;
+	fake_bytes_erased = 0;
+
+	/* Start every test with an empty cache. */
+	for (int i = 0; flash_cache && i < FLASH_CACHE_BLOCKS; i++)
+		flash_cache[i].valid = 0;
+	fake_ops.program_without_erase = 1;
+	flash_ops = &fake_ops;
+	return 0;
+}
+
+static void assert_read(uint32_t offset, uint32_t size)
+{
+	uint8_t buffer[FAKE_FLASH_SIZE];
+
+	assert_int_equal(flash_read(buffer, offset, size), size);
+	assert_memory_equal(buffer, fake_flash + offset, size);
+}
+
+static void test_read_hits_cache(void **state)
+{
+	assert_read(0x1010, 0x20);
+	assert_int_equal(fake_reads, 1);
+	assert_int_equal(fake_bytes_read, FLASH_CACHE_BLOCK_SIZE);
+
+	assert_read(0x1010, 0x20);
+	assert_read(0x1800, 0x100);
+	assert_int_equal(fake_reads, 1);
+}
+
+static void test_read_across_blocks(void **state)
+{
+	assert_read(0x1ff0, 0x20);
+	assert_int_equal(fake_reads, 2);
+	assert_read(0x1000, 0x2000);
+	assert_int_equal(fake_reads, 2);
+}
+
+static void test_large_read_bypasses_cache(void **state)
+{
+	assert_read(0x0, FLASH_CACHE_MAX_READ + 1);
+	assert_int_equal(fake_reads, 1);
+	assert_int_equal(fake_bytes_read, FLASH_CACHE_MAX_READ + 1);
+
+	assert_read(0x10, 0x10);
+	assert_int_equal(fake_reads, 2);
+}
+
+static void test_write_invalidates(void **state)
+{
+	uint8_t data[0x10];
+
+	assert_read(0x2000, 0x10);
+	memset(data, 0x5a, sizeof(data));
+	assert_int_equal(flash_write(data, 0x2008, sizeof(data)),
+			 sizeof(data));
+	assert_read(0x2000, 0x20);
+	assert_int_equal(fake_reads, 2);
+}
+
+static void test_erase_invalidates(void **state)
+{
+	assert_read(0x3000, 0x10);
+	assert_int_equal(flash_erase(0x3000, 0x1000), 0x1000);
+	assert_read(0x3000, 0x10);
+	assert_int_equal(fake_reads, 2);
+}
+
+static void test_rewrite_invalidates(void **state)
+{
+	uint8_t data[0x10];
+
+	assert_read(0x4000, 0x10);
+	memset(data, 0xa5, sizeof(data));
+	assert_int_equal(flash_rewrite(data, 0x4004, sizeof(data)),
+			 sizeof(data));
+	assert_read(0x4000, 0x20);
+}
+
+static void test_lru_eviction(void **state)
+{
+	/* Fill the cache, keeping the first block in use. */
+	for (int i = 0; i < FLASH_CACHE_BLOCKS; i++) {
+		assert_read(i * FLASH_CACHE_BLOCK_SIZE, 0x10);
+		assert_read(0x0, 0x10);
+	}
+	assert_int_equal(fake_reads, FLASH_CACHE_BLOCKS);
+
+	/* Evicts block 1, not block 0. */
+	assert_read(FLASH_CACHE_BLOCKS * FLASH_CACHE_BLOCK_SIZE, 0x10);
+	assert_read(0x0, 0x10);
+	assert_int_equal(fake_reads, FLASH_CACHE_BLOCKS + 1);
+	assert_read(FLASH_CACHE_BLOCK_SIZE, 0x10);
+	assert_int_equal(fake_reads, FLASH_CACHE_BLOCKS + 2);
+}
+
+static void test_stats(void **state)
+{
+	uint64_t requested = flash_bytes_requested;
+	uint64_t transferred = flash_bytes_transferred;
+
+	assert_read(0x5000, 0x10);
+	assert_read(0x5010, 0x10);
+	assert_int_equal(flash_bytes_requested - requested, 0x20);
+	assert_int_equal(flash_bytes_transferred - transferred,
+			 FLASH_CACHE_BLOCK_SIZE);
+}
+
+static void rewrite_and_check(const uint8_t *data, uint32_t offset,
+			      uint32_t size)
+{
+	assert_int_equal(flash_rewrite(data, offset, size), size);
+	assert_memory_equal(fake_flash + offset, data, size);
+}
+
+static void test_rewrite_unchanged(void **state)
+{
+	uint8_t data[0x3000];
+
+	memcpy(data, fake_flash + 0x1000, sizeof(data));
+	rewrite_and_check(data, 0x1000, sizeof(data));
+	assert_int_equal(fake_erases, 0);
+	assert_int_equal(fake_writes, 0);
+}
+
+static void test_rewrite_clears_bits(void **state)
+{
+	uint8_t data[0x100];
+
+	memcpy(data, fake_flash + 0x1100, sizeof(data));
+	data[0x10] &= 0x0f;
+	data[0x20] = 0;
+	rewrite_and_check(data, 0x1100, sizeof(data));
+	assert_int_equal(fake_erases, 0);
+	assert_int_equal(fake_writes, 1);
+	assert_int_equal(fake_bytes_written, 0x11);
+}
+
+static void test_rewrite_merges_erases(void **state)
+{
+	uint8_t data[0x4000];
+	uint8_t before[FAKE_FLASH_SIZE];
+
+	/* Sectors 1 and 2 need erasing, 3 is unchanged, 4 does again. */
+	memcpy(data, fake_flash + 0x1000, sizeof(data));
+	memset(data, 0xff, 0x2000);
+	data[0x3000] = ~data[0x3000];
+	memcpy(before, fake_flash, sizeof(before));
+	rewrite_and_check(data, 0x1000, sizeof(data));
+	assert_int_equal(fake_erases, 2);
+	assert_int_equal(fake_bytes_erased, 0x3000);
+
+	/* Nothing outside the range changed. */
+	assert_memory_equal(fake_flash, before, 0x1000);
+	assert_memory_equal(fake_flash + 0x5000, before + 0x5000,
+			    FAKE_FLASH_SIZE - 0x5000);
+}
+
+static void test_rewrite_unaligned(void **state)
+{
+	uint8_t data[0x1800];
+	uint8_t before[FAKE_FLASH_SIZE];
+
+	memset(data, 0x3c, sizeof(data));
+	memcpy(before, fake_flash, sizeof(before));
+	rewrite_and_check(data, 0x2400, sizeof(data));
+	assert_int_equal(fake_bytes_erased, 0x2000);
+	assert_memory_equal(fake_flash + 0x2000, before + 0x2000, 0x400);
+	assert_memory_equal(fake_flash + 0x3c00, before + 0x3c00, 0x400);
+}
+
+static void test_rewrite_needs_erase(void **state)
+{
+	uint8_t data[0x100];
+
+	/* Flash which can only be written right after an erase. */
+	fake_ops.program_without_erase = 0;
+
+	memcpy(data, fake_flash + 0x1100, sizeof(data));
+	data[0x10] &= 0x0f;
+	rewrite_and_check(data, 0x1100, sizeof(data));
+	assert_int_equal(fake_erases, 1);
+	assert_int_equal(fake_bytes_erased, 0x1000);
+	assert_int_equal(fake_writes, 1);
+	assert_int_equal(fake_bytes_written, 0x1000);
+
+	/* Unchanged sectors are still left alone. */
+	rewrite_and_check(data, 0x1100, sizeof(data));
+	assert_int_equal(fake_erases, 1);
+	assert_int_equal(fake_writes, 1);
+}
+
+static void test_mmio_copy(void **state)
+{
+	uint8_t dest[0x100 + 8];
+
+	for (int src_align = 0; src_align < 8; src_align++)
+		for (int dest_align = 0; dest_align < 8; dest_align++)
+			for (int size = 0; size <= 0x100; size++) {
+				memset(dest, 0, sizeof(dest));
+				flash_mmio_copy(dest + dest_align,
+						fake_flash + src_align, size);
+				assert_memory_equal(dest + dest_align,
+						    fake_flash + src_align,
+						    size);
+				assert_int_equal(dest[dest_align + size], 0);
+			}
+}
+
+#define FLASH_TEST(func) cmocka_unit_test_setup(func, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		FLASH_TEST(test_read_hits_cache),
+		FLASH_TEST(test_read_across_blocks),
+		FLASH_TEST(test_large_read_bypasses_cache),
+		FLASH_TEST(test_write_invalidates),
+		FLASH_TEST(test_erase_invalidates),
+		FLASH_TEST(test_rewrite_invalidates),
+		FLASH_TEST(test_lru_eviction),
+		FLASH_TEST(test_stats),
+		FLASH_TEST(test_rewrite_unchanged),
+		FLASH_TEST(test_rewrite_clears_bits),
+		FLASH_TEST(test_rewrite_merges_erases),
+		FLASH_TEST(test_rewrite_unaligned),
+		FLASH_TEST(test_rewrite_needs_erase),
+		FLASH_TEST(test_mmio_copy),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,369 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+
+#include "drivers/tpm/google/spi.h"
+#include "tests/test.h"
+
+#include "drivers/tpm/google/spi.c"
+
+/* Largest chunk the fake TPM accepts or hands out at a time. */
+#define FAKE_BURST_COUNT 63
+#define FAKE_FIFO_SIZE 2048
+/* Flow control polls a stalled FIFO transaction waits for. */
+#define FAKE_STALL_POLLS 3
+
+struct list_node cleanup_funcs;
+
+/* Every read of the clock moves it forward by a microsecond. */
+static uint64_t fake_clock_us = 1;
+
+uint64_t timer_raw_value(void)
+{
+	return fake_clock_us++;
+}
+
+/* Fake TPM behind the SPI bus. */
+static struct {
+	uint8_t access;
+	int data_avail;
+	uint8_t cmd[FAKE_FIFO_SIZE];
+	size_t cmd_len;
+	uint8_t rsp[FAKE_FIFO_SIZE];
+	size_t rsp_len;
+	size_t rsp_pos;
+	/* Size of the response to the next command. */
+	size_t next_rsp_size;
+	/*
+	 * If set, the burst count drops to this after the first FIFO
+	 * transaction of each command or response, and larger FIFO
+	 * transactions are stalled with flow control until there's room.
+	 */
+	uint32_t small_burst;
+	int fifo_transactions;
+
+	/* The SPI transaction in progress. */
+	uint8_t header[4];
+	size_t header_len;
+	int flow_control_done;
+	int stall_polls;
+	int read;
+	uint32_t addr;
+} fake;
+
+static struct {
+	int transactions;
+	int status_reads;
+	int wake_pulses;
+	int stalls;
+} stats;
+
+static void fake_generate_response(void)
+{
+	assert_int_equal(read_be32(fake.cmd + 2), fake.cmd_len);
+
+	fake.rsp[0] = 0x80;
+	fake.rsp[1] = 0x01;
+	fake.rsp[2] = fake.next_rsp_size >> 24;
+	fake.rsp[3] = fake.next_rsp_size >> 16;
+	fake.rsp[4] = fake.next_rsp_size >> 8;
+	fake.rsp[5] = fake.next_rsp_size;
+	memset(fake.rsp + 6, 0, 4);
+	for (size_t i = 10; i < fake.next_rsp_size; i++)
+		fake.rsp[i] = i * 7;
+	fake.rsp_len = fake.next_rsp_size;
+	fake.rsp_pos = 0;
+	fake.data_avail = 1;
+	fake.fifo_transactions = 0;
+}
+
+/* Whether the burst count has dropped to fake.small_burst. */
+static int fake_burst_shrunk(void)
+{
+	return fake.small_burst && fake.fifo_transactions;
+}
+
+static uint32_t fake_status(void)
+{
+	uint32_t burst = 0;
+	uint32_t status = TpmStsFamilyTpm2 | TpmStsValid;
+
+	if (fake.data_avail) {
+		status |= TpmStsDataAvail;
+		burst = MIN(FAKE_BURST_COUNT, fake.rsp_len - fake.rsp_pos);
+	} else {
+		status |= TpmStsDataExpect;
+		burst = FAKE_BURST_COUNT;
+	}
+	if (fake_burst_shrunk())
+		burst = MIN(burst, fake.small_burst);
+	return status | burst << TpmStsBurstCountShift;
+}
+
+static void fake_read_reg(uint8_t *data, size_t size)
+{
+	uint32_t value;
+
+	switch (fake.addr) {
+	case TPM_ACCESS_REG:
+		assert_int_equal(size, 1);
+		*data = fake.access;
+		break;
+	case TPM_STS_REG:
+		assert_int_equal(size, sizeof(value));
+		value = fake_status();
+		memcpy(data, &value, sizeof(value));
+		stats.status_reads++;
+		break;
+	case TPM_DATA_FIFO_REG:
+		assert_true(fake.data_avail);
+		assert_true(size <= FAKE_BURST_COUNT);
+		assert_true(fake.rsp_pos + size <= fake.rsp_len);
+		memcpy(data, fake.rsp + fake.rsp_pos, size);
+		fake.rsp_pos += size;
+		if (fake.rsp_pos == fake.rsp_len)
+			fake.data_avail = 0;
+		break;
+	case TPM_DID_VID_REG:
+		assert_int_equal(size, sizeof(value));
+		value = 0x00281ae0;
+		memcpy(data, &value, sizeof(value));
+		break;
+	case TPM_RID_REG:
+		assert_int_equal(size, 1);
+		*data = 0;
+		break;
+	default:
+		fail_msg("Read from unexpected register %#x", fake.addr);
+	}
+}
+
+static void fake_write_reg(const uint8_t *data, size_t size)
+{
+	uint32_t value;
+
+	switch (fake.addr) {
+	case TPM_ACCESS_REG:
+		assert_int_equal(size, 1);
+		if (*data & TpmAccessRequestUse)
+			fake.access |= TpmAccessActiveLocality;
+		break;
+	case TPM_STS_REG:
+		assert_int_equal(size, sizeof(value));
+		memcpy(&value, data, sizeof(value));
+		if (value & TpmStsCommandReady) {
+			fake.cmd_len = 0;
+			fake.data_avail = 0;
+			fake.fifo_transactions = 0;
+		}
+		if (value & TpmStsGo)
+			fake_generate_response();
+		break;
+	case TPM_DATA_FIFO_REG:
+		assert_false(fake.data_avail);
+		assert_true(size <= FAKE_BURST_COUNT);
+		assert_true(fake.cmd_len + size <= sizeof(fake.cmd));
+		memcpy(fake.cmd + fake.cmd_len, data, size);
+		fake.cmd_len += size;
+		break;
+	default:
+		fail_msg("Write to unexpected register %#x", fake.addr);
+	}
+}
+
+static int fake_spi_start(SpiOps *me)
+{
+	fake.header_len = 0;
+	fake.flow_control_done = 0;
+	fake.stall_polls = 0;
+	return 0;
+}
+
+static int fake_spi_transfer(SpiOps *me, void *in, const void *out,
+			     uint32_t size)
+{
+	if (fake.header_len < sizeof(fake.header)) {
+		assert_non_null(out);
+		assert_true(fake.header_len + size <= sizeof(fake.header));
+		memcpy(fake.header + fake.header_len, out, size);
+		fake.header_len += size;
+		if (fake.header_len == sizeof(fake.header)) {
+			fake.read = !!(fake.header[0] & 0x80);
+			fake.addr = fake.header[1] << 16 |
+				    fake.header[2] << 8 | fake.header[3];
+			stats.transactions++;
+		}
+		return 0;
+	}
+
+	if (!fake.flow_control_done) {
+		size_t len = (fake.header[0] & 0x3f) + 1;
+
+		assert_int_equal(size, 1);
+		/* Stall FIFO transactions that don't fit in the burst. */
+		if (fake.addr == TPM_DATA_FIFO_REG && fake_burst_shrunk() &&
+		    len > fake.small_burst &&
+		    fake.stall_polls < FAKE_STALL_POLLS) {
+			if (!fake.stall_polls++)
+				stats.stalls++;
+			*(uint8_t *)in = 0;
+			return 0;
+		}
+		*(uint8_t *)in = 1;
+		fake.flow_control_done = 1;
+		return 0;
+	}
+
+	assert_int_equal(size, (fake.header[0] & 0x3f) + 1);
+	if (fake.addr == TPM_DATA_FIFO_REG)
+		fake.fifo_transactions++;
+	if (fake.read)
+		fake_read_reg(in, size);
+	else
+		fake_write_reg(out, size);
+	return 0;
+}
+
+static int fake_spi_stop(SpiOps *me)
+{
+	/* Chip select pulsed without a transaction. */
+	if (!fake.header_len)
+		stats.wake_pulses++;
+	return 0;
+}
+
+static SpiOps fake_spi = {
+	.start = fake_spi_start,
+	.transfer = fake_spi_transfer,
+	.stop = fake_spi_stop,
+};
+
+static int fake_irq_status(void)
+{
+	return 1;
+}
+
+/* Helpers */
+
+static size_t send_command(TpmOps *tpm, size_t cmd_size, size_t rsp_size)
+{
+	uint8_t cmd[FAKE_FIFO_SIZE];
+	uint8_t rsp[FAKE_FIFO_SIZE];
+	size_t rsp_len = sizeof(rsp);
+
+	memset(cmd, 0x5a, cmd_size);
+	cmd[0] = 0x80;
+	cmd[1] = 0x01;
+	cmd[2] = cmd_size >> 24;
+	cmd[3] = cmd_size >> 16;
+	cmd[4] = cmd_size >> 8;
+	cmd[5] = cmd_size;
+	fake.next_rsp_size = rsp_size;
+
+	memset(&stats, 0, sizeof(stats));
+	assert_int_equal(tpm->xmit(tpm, cmd, cmd_size, rsp, &rsp_len), 0);
+	assert_int_equal(rsp_len, rsp_size);
+	assert_memory_equal(rsp, fake.rsp, rsp_size);
+	assert_memory_equal(fake.cmd, cmd, cmd_size);
+	return rsp_len;
+}
+
+static int setup(void **state)
+{
+	SpiTpm *tpm;
+
+	memset(&fake, 0, sizeof(fake));
+	fake.access = TpmAccessValid;
+	tpm = new_tpm_spi(&fake_spi, fake_irq_status);
+	/* Get the one time initialization out of the way. */
+	send_command(&tpm->ops, 12, 10);
+	*state = tpm;
+	return 0;
+}
+
+/* Tests */
+
+static void test_transactions_per_command(void **state)
+{
+	SpiTpm *tpm = *state;
+	static const struct {
+		const char *name;
+		size_t cmd_size;
+		size_t rsp_size;
+	} cases[] = {
+		{ "GetCapability", 22, 27 },
+		{ "PCR_Extend", 1024, 19 },
+		{ "NV_Read", 35, 1050 },
+	};
+
+	printf("%-16s %8s %8s %13s %13s\n", "command", "cmd size", "rsp size",
+	       "transactions", "status reads");
+	for (int i = 0; i < ARRAY_SIZE(cases); i++) {
+		size_t cmd_size = cases[i].cmd_size;
+		size_t rsp_size = cases[i].rsp_size;
+
+		send_command(&tpm->ops, cmd_size, rsp_size);
+		printf("%-16s %8zu %8zu %13d %13d\n", cases[i].name,
+		       cmd_size, rsp_size, stats.transactions,
+		       stats.status_reads);
+
+		/*
+		 * Command ready, Go, the response header, the last response
+		 * byte and the closing command ready, four status reads and
+		 * then the FIFO chunks themselves.
+		 */
+		assert_int_equal(stats.transactions,
+			9 + DIV_ROUND_UP(cmd_size, FAKE_BURST_COUNT) +
+			DIV_ROUND_UP(rsp_size - 7, FAKE_BURST_COUNT));
+		assert_int_equal(stats.status_reads, 4);
+	}
+}
+
+static void test_wake_pulse_only_after_idle(void **state)
+{
+	SpiTpm *tpm = *state;
+
+	send_command(&tpm->ops, 12, 10);
+	assert_int_equal(stats.wake_pulses, 0);
+
+	fake_clock_us += USECS_PER_SEC;
+	send_command(&tpm->ops, 12, 10);
+	assert_int_equal(stats.wake_pulses, 1);
+
+	send_command(&tpm->ops, 12, 10);
+	assert_int_equal(stats.wake_pulses, 0);
+}
+
+static void test_burst_count_shrinks_mid_command(void **state)
+{
+	SpiTpm *tpm = *state;
+
+	/*
+	 * The burst count read before the first chunk is out of date for
+	 * every chunk after it. The TPM holds those off with flow control
+	 * and the command still goes through.
+	 */
+	fake.small_burst = 8;
+	send_command(&tpm->ops, 1024, 1050);
+	assert_int_equal(stats.stalls,
+			 DIV_ROUND_UP(1024, FAKE_BURST_COUNT) - 1 +
+			 DIV_ROUND_UP(1050 - 7, FAKE_BURST_COUNT));
+
+	/* Once the burst count is back, nothing is stalled. */
+	fake.small_burst = 0;
+	send_command(&tpm->ops, 1024, 1050);
+	assert_int_equal(stats.stalls, 0);
+}
+
+#define SPI_TPM_TEST(func) cmocka_unit_test_setup(func, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		SPI_TPM_TEST(test_transactions_per_command),
+		SPI_TPM_TEST(test_wake_pulse_only_after_idle),
+		SPI_TPM_TEST(test_burst_count_shrinks_mid_command),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
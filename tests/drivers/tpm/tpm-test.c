@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+#include <tss_constants.h>
+
+#include "drivers/tpm/tpm.h"
+#include "tests/test.h"
+
+#include "drivers/tpm/tpm.c"
+
+#define TEST_RC_ERROR 0x922
+#define TEST_NV_INDEX 0x100a
+#define TEST_CC_NV_WRITE 0x137
+
+/* Fake TPM which numbers its responses. */
+static struct {
+	TpmOps ops;
+	uint32_t rc;
+	int xmits;
+} fake;
+
+/* Mocks */
+
+static int fake_xmit(struct TpmOps *me, const uint8_t *sendbuf,
+		     size_t send_size, uint8_t *recvbuf, size_t *recv_len)
+{
+	assert_true(*recv_len >= TpmRspHeaderSize + sizeof(uint32_t));
+	fake.xmits++;
+
+	/* Responses carry a serial number to tell them apart. */
+	be16enc(recvbuf, 0x8001);
+	be32enc(recvbuf + TpmCmdCountOffset,
+		TpmRspHeaderSize + sizeof(uint32_t));
+	be32enc(recvbuf + TpmRspCodeOffset, fake.rc);
+	be32enc(recvbuf + TpmRspHeaderSize, fake.xmits);
+	*recv_len = TpmRspHeaderSize + sizeof(uint32_t);
+	return 0;
+}
+
+/* Helpers */
+
+static uint32_t send_cmd(uint32_t ordinal, uint32_t arg)
+{
+	uint8_t cmd[14];
+	uint8_t rsp[64];
+	size_t rsp_len = sizeof(rsp);
+
+	be16enc(cmd, 0x8002);
+	be32enc(cmd + TpmCmdCountOffset, sizeof(cmd));
+	be32enc(cmd + TpmCmdOrdinalOffset, ordinal);
+	be32enc(cmd + 10, arg);
+
+	assert_int_equal(tpm_xmit(cmd, sizeof(cmd), rsp, &rsp_len), 0);
+	assert_int_equal(rsp_len, TpmRspHeaderSize + sizeof(uint32_t));
+	return be32dec(rsp + TpmRspHeaderSize);
+}
+
+static int setup(void **state)
+{
+	memset(&fake, 0, sizeof(fake));
+	fake.ops.xmit = &fake_xmit;
+
+	tpm_ops = NULL;
+	tpm_nv_cache_clear();
+	tpm_set_ops(&fake.ops);
+	return 0;
+}
+
+/* Tests */
+
+static void test_nv_read_cached(void **state)
+{
+	uint32_t first = send_cmd(Tpm2CcNvRead, TEST_NV_INDEX);
+
+	assert_int_equal(send_cmd(Tpm2CcNvRead, TEST_NV_INDEX), first);
+	assert_int_equal(send_cmd(Tpm2CcNvReadPublic, TEST_NV_INDEX),
+			 first + 1);
+	assert_int_equal(send_cmd(Tpm2CcNvReadPublic, TEST_NV_INDEX),
+			 first + 1);
+	assert_int_equal(send_cmd(Tpm2CcNvRead, TEST_NV_INDEX), first);
+	assert_int_equal(fake.xmits, 2);
+}
+
+static void test_nv_read_other_index(void **state)
+{
+	uint32_t first = send_cmd(Tpm2CcNvRead, TEST_NV_INDEX);
+
+	assert_int_not_equal(send_cmd(Tpm2CcNvRead, TEST_NV_INDEX + 1),
+			     first);
+	assert_int_equal(fake.xmits, 2);
+}
+
+static void test_nv_read_cache_cleared(void **state)
+{
+	uint32_t first = send_cmd(Tpm2CcNvRead, TEST_NV_INDEX);
+
+	send_cmd(TEST_CC_NV_WRITE, TEST_NV_INDEX);
+	assert_int_not_equal(send_cmd(Tpm2CcNvRead, TEST_NV_INDEX), first);
+	assert_int_equal(fake.xmits, 3);
+}
+
+static void test_nv_read_cache_evicts_oldest(void **state)
+{
+	for (int i = 0; i <= TPM_NV_CACHE_ENTRIES; i++)
+		send_cmd(Tpm2CcNvRead, TEST_NV_INDEX + i);
+	assert_int_equal(fake.xmits, TPM_NV_CACHE_ENTRIES + 1);
+
+	send_cmd(Tpm2CcNvRead, TEST_NV_INDEX + TPM_NV_CACHE_ENTRIES);
+	assert_int_equal(fake.xmits, TPM_NV_CACHE_ENTRIES + 1);
+	send_cmd(Tpm2CcNvRead, TEST_NV_INDEX);
+	assert_int_equal(fake.xmits, TPM_NV_CACHE_ENTRIES + 2);
+}
+
+static void test_nv_read_error_not_cached(void **state)
+{
+	fake.rc = TEST_RC_ERROR;
+	send_cmd(Tpm2CcNvRead, TEST_NV_INDEX);
+	send_cmd(Tpm2CcNvRead, TEST_NV_INDEX);
+	assert_int_equal(fake.xmits, 2);
+}
+
+#define TPM_TEST(func) cmocka_unit_test_setup(func, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		TPM_TEST(test_nv_read_cached),
+		TPM_TEST(test_nv_read_other_index),
+		TPM_TEST(test_nv_read_cache_cleared),
+		TPM_TEST(test_nv_read_cache_evicts_oldest),
+		TPM_TEST(test_nv_read_error_not_cached),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,503 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+
+#include "tests/test.h"
+
+#include "fastboot/lz4.c"
+
+/* Header checksums as written by the lz4 tool, for a BD of 64 KiB blocks. */
+#define FLG_INDEPENDENT 0x60
+#define HC_INDEPENDENT 0x82
+#define FLG_LINKED 0x40
+#define HC_LINKED 0xc0
+#define FLG_BLOCK_CHECKSUM 0x70
+#define HC_BLOCK_CHECKSUM 0xad
+#define FLG_CONTENT_CHECKSUM 0x64
+#define HC_CONTENT_CHECKSUM 0xa7
+#define BD_64K 0x40
+
+#define WINDOW_SIZE (LZ4_HISTORY_SIZE + 4 * KiB)
+
+static uint8_t input[64 * KiB];
+static size_t input_len;
+static size_t block_start;
+
+/* What the input decompresses to. */
+static uint8_t expected[512 * KiB];
+static size_t expected_len;
+
+static uint8_t output[512 * KiB];
+static uint8_t window[WINDOW_SIZE];
+static size_t flushed;
+
+static struct lz4_decoder decoder;
+
+static int setup(void **state)
+{
+	input_len = 0;
+	expected_len = 0;
+	flushed = 0;
+	memset(output, 0, sizeof(output));
+	return 0;
+}
+
+/*
+ * Helpers to put together LZ4 frames. Apart from the made up checksums, the
+ * frames in these tests decompress the same with the reference lz4 tool.
+ */
+
+static void put(const void *data, size_t len)
+{
+	assert_true(input_len + len <= sizeof(input));
+	memcpy(input + input_len, data, len);
+	input_len += len;
+}
+
+static void put_byte(uint8_t byte)
+{
+	put(&byte, 1);
+}
+
+static void put_le32(uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		put_byte(value >> (i * 8));
+}
+
+static void frame_hdr(uint8_t flg, uint8_t hc)
+{
+	put_le32(LZ4_FRAME_MAGIC);
+	put_byte(flg);
+	put_byte(BD_64K);
+	put_byte(hc);
+}
+
+static void end_mark(void)
+{
+	put_le32(0);
+}
+
+static void block_begin(void)
+{
+	block_start = input_len;
+	put_le32(0);
+}
+
+static void block_end(void)
+{
+	uint32_t size = input_len - block_start - 4;
+
+	for (int i = 0; i < 4; i++)
+		input[block_start + i] = size >> (i * 8);
+}
+
+static void put_len(uint32_t len)
+{
+	for (; len >= 0xff; len -= 0xff)
+		put_byte(0xff);
+	put_byte(len);
+}
+
+/*
+ * A sequence of literals followed by a match, or with match_len 0 just
+ * literals, the way the last sequence of a block is.
+ */
+static void sequence(const char *literals, uint32_t literal_len,
+		     uint16_t offset, uint32_t match_len)
+{
+	uint32_t match_code = match_len ? match_len - LZ4_MIN_MATCH : 0;
+
+	put_byte(MIN(literal_len, 0xf) << 4 | MIN(match_code, 0xf));
+	if (literal_len >= 0xf)
+		put_len(literal_len - 0xf);
+	put(literals, literal_len);
+
+	assert_true(expected_len + literal_len + match_len <=
+		    sizeof(expected));
+	memcpy(expected + expected_len, literals, literal_len);
+	expected_len += literal_len;
+
+	if (!match_len)
+		return;
+	put_byte(offset);
+	put_byte(offset >> 8);
+	if (match_code >= 0xf)
+		put_len(match_code - 0xf);
+
+	/* Byte by byte, the way overlapping matches are defined. */
+	assert_true(offset <= expected_len);
+	for (uint32_t i = 0; i < match_len; i++, expected_len++)
+		expected[expected_len] = expected[expected_len - offset];
+}
+
+static void raw_block(const char *data, uint32_t len)
+{
+	put_le32(len | LZ4_BLOCK_UNCOMPRESSED);
+	put(data, len);
+	memcpy(expected + expected_len, data, len);
+	expected_len += len;
+}
+
+static int collect_flush(void *ctx, const void *data, uint64_t len)
+{
+	assert_ptr_equal(ctx, &decoder);
+	assert_true(flushed + len <= sizeof(output));
+	memcpy(output + flushed, data, len);
+	flushed += len;
+	return 0;
+}
+
+static int fail_flush(void *ctx, const void *data, uint64_t len)
+{
+	return -1;
+}
+
+/* Decompress the input fed in pieces of the given size. */
+static int decompress(size_t piece, uint64_t *size)
+{
+	lz4_decoder_init(&decoder, output, sizeof(output), NULL, NULL);
+	for (size_t pos = 0; pos < input_len; pos += piece) {
+		if (lz4_decoder_feed(&decoder, input + pos,
+				     MIN(piece, input_len - pos)))
+			return -1;
+	}
+	return lz4_decoder_finish(&decoder, size);
+}
+
+/* Decompress the input fed in every size of piece up to max_piece. */
+static void assert_decompresses(size_t max_piece)
+{
+	for (size_t piece = 1; piece <= max_piece; piece++) {
+		uint64_t size = 0;
+
+		memset(output, 0, sizeof(output));
+		assert_int_equal(decompress(piece, &size), 0);
+		assert_int_equal(size, expected_len);
+		assert_memory_equal(output, expected, expected_len);
+	}
+}
+
+static void assert_corrupt(const char *error)
+{
+	uint64_t size;
+
+	assert_int_equal(decompress(input_len, &size), -1);
+	assert_string_equal(decoder.error, error);
+}
+
+/* Tests */
+
+static void test_literals(void **state)
+{
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	sequence("hello", 5, 0, 0);
+	block_end();
+	end_mark();
+
+	assert_decompresses(input_len);
+}
+
+static void test_long_lengths(void **state)
+{
+	char literals[600];
+
+	for (int i = 0; i < sizeof(literals); i++)
+		literals[i] = 'a' + i % 26;
+
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	/* 15 exactly needs an extra length byte of 0. */
+	sequence(literals, 15, 15, 19);
+	sequence(literals, 270, 26, 0xf + LZ4_MIN_MATCH + 0xff);
+	sequence(literals, 0xf + 0xff + 0xff, 0, 0);
+	block_end();
+	end_mark();
+
+	assert_decompresses(input_len);
+}
+
+static void test_overlapping_matches(void **state)
+{
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	/* A run of one byte. */
+	sequence("a", 1, 1, 300);
+	/* Repeating pattern shorter than the match. */
+	sequence("xyz", 3, 3, 40);
+	/* Match reaching back to the start of the output. */
+	sequence("0123456789", 10, expected_len + 10, 50);
+	sequence("end!!", 5, 0, 0);
+	block_end();
+	end_mark();
+
+	assert_decompresses(input_len);
+	assert_memory_equal(expected + 1, "aaaaaaaa", 8);
+	assert_memory_equal(expected + 301, "xyzxyzxyz", 9);
+}
+
+static void test_linked_blocks(void **state)
+{
+	frame_hdr(FLG_LINKED, HC_LINKED);
+	block_begin();
+	sequence("first block ", 12, 6, 6);
+	sequence("-----", 5, 0, 0);
+	block_end();
+	raw_block("uncompressed ", 13);
+	/* Matches can reach into earlier blocks. */
+	block_begin();
+	sequence("", 0, expected_len, 18);
+	sequence("tail.", 5, 0, 0);
+	block_end();
+	end_mark();
+
+	assert_decompresses(input_len);
+	assert_memory_equal(output,
+			    "first block block -----uncompressed first", 41);
+}
+
+static void test_frames_and_skippable_frames(void **state)
+{
+	put_le32(LZ4_SKIPPABLE_MAGIC | 0xa);
+	put_le32(3);
+	put("abc", 3);
+
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	sequence("one ", 4, 0, 0);
+	block_end();
+	end_mark();
+
+	put_le32(LZ4_SKIPPABLE_MAGIC);
+	put_le32(0);
+
+	/* Checksums are read, but not checked. */
+	frame_hdr(FLG_BLOCK_CHECKSUM, HC_BLOCK_CHECKSUM);
+	block_begin();
+	sequence("two ", 4, 0, 0);
+	block_end();
+	put_le32(0x12345678);
+	end_mark();
+
+	frame_hdr(FLG_CONTENT_CHECKSUM, HC_CONTENT_CHECKSUM);
+	raw_block("three", 5);
+	end_mark();
+	put_le32(0x9abcdef0);
+
+	assert_decompresses(input_len);
+	assert_memory_equal(output, "one two three", 13);
+}
+
+static void test_content_size(void **state)
+{
+	put_le32(LZ4_FRAME_MAGIC);
+	put_byte(FLG_INDEPENDENT | LZ4_FLG_CONTENT_SIZE);
+	put_byte(BD_64K);
+	put_le32(5);
+	put_le32(0);
+	put_byte(0x61);
+	block_begin();
+	sequence("sized", 5, 0, 0);
+	block_end();
+	end_mark();
+
+	assert_decompresses(input_len);
+}
+
+static void test_flush(void **state)
+{
+	uint64_t size = 0;
+
+	/* Much more output than fits in the window. */
+	frame_hdr(FLG_LINKED, HC_LINKED);
+	for (int i = 0; i < 8; i++) {
+		char literals[16];
+
+		snprintf(literals, sizeof(literals), "block %d ", i);
+		block_begin();
+		sequence(literals, strlen(literals), 1, 20000);
+		sequence(literals, strlen(literals), 20000, 25000);
+		sequence("end", 3, 0, 0);
+		block_end();
+	}
+	end_mark();
+
+	for (size_t piece = 1; piece <= input_len; piece += 7) {
+		flushed = 0;
+		memset(output, 0, sizeof(output));
+		lz4_decoder_init(&decoder, window, sizeof(window),
+				 collect_flush, &decoder);
+		for (size_t pos = 0; pos < input_len; pos += piece)
+			assert_int_equal(lz4_decoder_feed(&decoder,
+					 input + pos,
+					 MIN(piece, input_len - pos)), 0);
+		assert_int_equal(lz4_decoder_finish(&decoder, &size), 0);
+		assert_int_equal(size, expected_len);
+		assert_int_equal(flushed, expected_len);
+		assert_memory_equal(output, expected, expected_len);
+	}
+}
+
+static void test_output_too_big(void **state)
+{
+	uint64_t size;
+
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	sequence("a", 1, 1, WINDOW_SIZE);
+	sequence("end", 3, 0, 0);
+	block_end();
+	end_mark();
+
+	lz4_decoder_init(&decoder, window, sizeof(window), NULL, NULL);
+	assert_int_equal(lz4_decoder_feed(&decoder, input, input_len), -1);
+	assert_string_equal(decoder.error, "Decompressed image is too big");
+	assert_int_equal(lz4_decoder_finish(&decoder, &size), -1);
+}
+
+static void test_flush_fails(void **state)
+{
+	uint64_t size;
+
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	sequence("a", 1, 1, WINDOW_SIZE);
+	sequence("end", 3, 0, 0);
+	block_end();
+	end_mark();
+
+	lz4_decoder_init(&decoder, window, sizeof(window), fail_flush, NULL);
+	assert_int_equal(lz4_decoder_feed(&decoder, input, input_len), -1);
+	assert_string_equal(decoder.error, "Failed to write");
+	assert_int_equal(lz4_decoder_finish(&decoder, &size), -1);
+}
+
+static void test_not_lz4(void **state)
+{
+	put("\x1f\x8b\x08\x00", 4);
+	assert_corrupt("Not an LZ4 frame");
+}
+
+static void test_bad_frame_descriptor(void **state)
+{
+	frame_hdr(0xa0, 0);
+	assert_corrupt("Unsupported LZ4 frame version");
+
+	setup(state);
+	frame_hdr(FLG_INDEPENDENT | LZ4_FLG_DICT_ID, 0);
+	assert_corrupt("LZ4 dictionaries aren't supported");
+
+	setup(state);
+	put_le32(LZ4_FRAME_MAGIC);
+	put_byte(FLG_INDEPENDENT);
+	put_byte(0x30);
+	put_byte(0);
+	assert_corrupt("Bad LZ4 block size");
+}
+
+static void test_block_too_big(void **state)
+{
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	put_le32(64 * KiB + 1);
+	assert_corrupt("LZ4 block too big");
+}
+
+static void test_bad_match_offset(void **state)
+{
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	put_byte(0x10);
+	put_byte('a');
+	put_byte(0);
+	put_byte(0);
+	block_end();
+	end_mark();
+	assert_corrupt("Corrupt LZ4 data");
+
+	/* Further back than the start of the output. */
+	setup(state);
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	put_byte(0x10);
+	put_byte('a');
+	put_byte(2);
+	put_byte(0);
+	block_end();
+	end_mark();
+	assert_corrupt("Corrupt LZ4 data");
+}
+
+static void test_sequence_past_block_end(void **state)
+{
+	/* Literals running past the end of the block. */
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	put_byte(0x50);
+	put("abc", 3);
+	block_end();
+	put("de", 2);
+	end_mark();
+	assert_corrupt("Corrupt LZ4 data");
+
+	/* Offset cut off by the end of the block. */
+	setup(state);
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	put_byte(0x10);
+	put_byte('a');
+	put_byte(1);
+	block_end();
+	put_byte(0);
+	end_mark();
+	assert_corrupt("Corrupt LZ4 data");
+}
+
+static void test_truncated(void **state)
+{
+	uint64_t size;
+
+	frame_hdr(FLG_INDEPENDENT, HC_INDEPENDENT);
+	block_begin();
+	sequence("hello", 5, 0, 0);
+	block_end();
+	end_mark();
+
+	/* Cut off anywhere, including between frame header fields. */
+	for (size_t len = 1; len < input_len; len++) {
+		lz4_decoder_init(&decoder, output, sizeof(output), NULL,
+				 NULL);
+		assert_int_equal(lz4_decoder_feed(&decoder, input, len), 0);
+		assert_int_equal(lz4_decoder_finish(&decoder, &size), -1);
+		assert_string_equal(decoder.error,
+				    "Compressed image ended abruptly");
+	}
+
+	lz4_decoder_init(&decoder, output, sizeof(output), NULL, NULL);
+	assert_int_equal(lz4_decoder_finish(&decoder, &size), -1);
+}
+
+#define TEST(fn) cmocka_unit_test_setup(fn, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		TEST(test_literals),
+		TEST(test_long_lengths),
+		TEST(test_overlapping_matches),
+		TEST(test_linked_blocks),
+		TEST(test_frames_and_skippable_frames),
+		TEST(test_content_size),
+		TEST(test_flush),
+		TEST(test_output_too_big),
+		TEST(test_flush_fails),
+		TEST(test_not_lz4),
+		TEST(test_bad_frame_descriptor),
+		TEST(test_block_too_big),
+		TEST(test_bad_match_offset),
+		TEST(test_sequence_past_block_end),
+		TEST(test_truncated),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,584 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+
+#include "tests/test.h"
+
+#include "fastboot/sparse.c"
+
+#define BLOCK_SIZE 512
+#define DISK_BLOCKS 64
+#define PART_START 8
+#define PART_BLOCKS 32
+#define STAGE_BLOCKS 4
+
+/* Fake block device, logging every command it gets. */
+
+enum fake_op_type {
+	OP_WRITE,
+	OP_FILL,
+	OP_ERASE,
+};
+
+struct fake_op {
+	enum fake_op_type type;
+	lba_t start;
+	lba_t count;
+	uint32_t fill;
+};
+
+static uint8_t disk_data[DISK_BLOCKS * BLOCK_SIZE];
+static struct fake_op op_log[32];
+static int op_count;
+static bool erase_fails;
+
+static void log_op(enum fake_op_type type, lba_t start, lba_t count,
+		   uint32_t fill)
+{
+	assert_true(op_count < ARRAY_SIZE(op_log));
+	assert_true(start >= PART_START);
+	assert_true(start + count <= PART_START + PART_BLOCKS);
+	op_log[op_count++] = (struct fake_op){type, start, count, fill};
+}
+
+static lba_t fake_write(BlockDevOps *me, lba_t start, lba_t count,
+			const void *buffer)
+{
+	log_op(OP_WRITE, start, count, 0);
+	memcpy(disk_data + start * BLOCK_SIZE, buffer, count * BLOCK_SIZE);
+	return count;
+}
+
+static lba_t fake_fill_write(BlockDevOps *me, lba_t start, lba_t count,
+			     uint32_t fill_pattern)
+{
+	log_op(OP_FILL, start, count, fill_pattern);
+	for (size_t i = 0; i < count * BLOCK_SIZE; i += sizeof(fill_pattern))
+		memcpy(disk_data + start * BLOCK_SIZE + i, &fill_pattern,
+		       sizeof(fill_pattern));
+	return count;
+}
+
+static lba_t fake_erase(BlockDevOps *me, lba_t start, lba_t count)
+{
+	log_op(OP_ERASE, start, count, 0);
+	if (erase_fails)
+		return 0;
+	memset(disk_data + start * BLOCK_SIZE, 0, count * BLOCK_SIZE);
+	return count;
+}
+
+static BlockDev fake_disk = {
+	.ops = {
+		.write = fake_write,
+		.fill_write = fake_fill_write,
+	},
+	.block_size = BLOCK_SIZE,
+};
+
+static GptEntry partition = {
+	.starting_lba = PART_START,
+	.ending_lba = PART_START + PART_BLOCKS - 1,
+};
+
+static uint8_t stage[STAGE_BLOCKS * BLOCK_SIZE];
+static struct image_writer writer;
+
+/* The image being written. */
+static uint8_t image[(PART_BLOCKS + 16) * BLOCK_SIZE];
+static size_t image_len;
+
+static int setup(void **state)
+{
+	memset(disk_data, 0xee, sizeof(disk_data));
+	op_count = 0;
+	erase_fails = false;
+	fake_disk.ops.erase = NULL;
+	fake_disk.erase_zeroes = 0;
+	image_len = 0;
+	return 0;
+}
+
+/* Helpers */
+
+static void image_add(const void *data, size_t len)
+{
+	assert_true(image_len + len <= sizeof(image));
+	memcpy(image + image_len, data, len);
+	image_len += len;
+}
+
+static void image_hdr(uint32_t chunks)
+{
+	struct sparse_image_hdr hdr = {
+		.magic = SPARSE_IMAGE_MAGIC,
+		.major_version = 1,
+		.file_hdr_size = sizeof(struct sparse_image_hdr),
+		.chunk_hdr_size = sizeof(struct sparse_chunk_hdr),
+		.blk_size = BLOCK_SIZE,
+		.total_blks = PART_BLOCKS,
+		.total_chunks = chunks,
+	};
+
+	image_add(&hdr, sizeof(hdr));
+}
+
+static void chunk_hdr(uint16_t type, uint32_t blocks, uint32_t data_len)
+{
+	struct sparse_chunk_hdr hdr = {
+		.type = type,
+		.size_in_blks = blocks,
+		.total_size_bytes = sizeof(hdr) + data_len,
+	};
+
+	image_add(&hdr, sizeof(hdr));
+}
+
+/* Raw chunk with every byte set to value. */
+static void chunk_raw(uint32_t blocks, uint8_t value)
+{
+	chunk_hdr(CHUNK_TYPE_RAW, blocks, blocks * BLOCK_SIZE);
+	assert_true(image_len + blocks * BLOCK_SIZE <= sizeof(image));
+	memset(image + image_len, value, blocks * BLOCK_SIZE);
+	image_len += blocks * BLOCK_SIZE;
+}
+
+static void chunk_fill(uint32_t blocks, uint32_t pattern)
+{
+	chunk_hdr(CHUNK_TYPE_FILL, blocks, sizeof(pattern));
+	image_add(&pattern, sizeof(pattern));
+}
+
+static void chunk_dont_care(uint32_t blocks)
+{
+	chunk_hdr(CHUNK_TYPE_DONT_CARE, blocks, 0);
+}
+
+static void chunk_crc32(uint32_t crc)
+{
+	chunk_hdr(CHUNK_TYPE_CRC32, 0, sizeof(crc));
+	image_add(&crc, sizeof(crc));
+}
+
+/* Feed the image to a new writer in pieces of the given size. */
+static int write_image(size_t piece)
+{
+	struct fastboot_disk disk = { .disk = &fake_disk };
+
+	image_writer_init(&writer, &disk, &partition, stage, sizeof(stage));
+	for (size_t pos = 0; pos < image_len; pos += piece) {
+		if (image_writer_feed(&writer, image + pos,
+				      MIN(piece, image_len - pos)))
+			return -1;
+	}
+	return image_writer_finish(&writer);
+}
+
+static void assert_op(int index, enum fake_op_type type, lba_t start,
+		      lba_t count)
+{
+	assert_true(index < op_count);
+	assert_int_equal(op_log[index].type, type);
+	assert_int_equal(op_log[index].start, start);
+	assert_int_equal(op_log[index].count, count);
+}
+
+/* Checks that every byte of the blocks is value. */
+static void assert_blocks(lba_t start, lba_t count, uint8_t value)
+{
+	for (size_t i = 0; i < count * BLOCK_SIZE; i++)
+		assert_int_equal(disk_data[start * BLOCK_SIZE + i], value);
+}
+
+static void assert_pattern(lba_t start, lba_t count, uint32_t pattern)
+{
+	for (size_t i = 0; i < count * BLOCK_SIZE; i += sizeof(pattern)) {
+		uint32_t word;
+		memcpy(&word, disk_data + start * BLOCK_SIZE + i,
+		       sizeof(word));
+		assert_int_equal(word, pattern);
+	}
+}
+
+/* Tests */
+
+static void test_raw_image(void **state)
+{
+	/* Not a multiple of the block size, the end gets padded. */
+	memset(image, 0x5a, 5 * BLOCK_SIZE + 100);
+	image_len = 5 * BLOCK_SIZE + 100;
+
+	assert_int_equal(write_image(1000), 0);
+	assert_blocks(PART_START, 5, 0x5a);
+	assert_memory_equal(disk_data + (PART_START + 5) * BLOCK_SIZE, image,
+			    100);
+	assert_blocks(PART_START + 6, 1, 0xee);
+	for (size_t i = 100; i < BLOCK_SIZE; i++)
+		assert_int_equal(disk_data[(PART_START + 5) * BLOCK_SIZE + i],
+				 0);
+}
+
+static void test_raw_image_too_big(void **state)
+{
+	memset(image, 0x5a, PART_BLOCKS * BLOCK_SIZE + 1);
+	image_len = PART_BLOCKS * BLOCK_SIZE + 1;
+
+	assert_int_equal(write_image(image_len), -1);
+	assert_string_equal(writer.error, "Image is too big");
+}
+
+static void test_raw_chunks_written_together(void **state)
+{
+	image_hdr(2);
+	chunk_raw(1, 0x11);
+	chunk_raw(2, 0x22);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 1);
+	assert_op(0, OP_WRITE, PART_START, 3);
+	assert_blocks(PART_START, 1, 0x11);
+	assert_blocks(PART_START + 1, 2, 0x22);
+}
+
+static void test_fill_chunk(void **state)
+{
+	image_hdr(3);
+	chunk_raw(1, 0x11);
+	chunk_fill(3, 0xdeadbeef);
+	chunk_raw(1, 0x22);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 3);
+	assert_op(0, OP_WRITE, PART_START, 1);
+	assert_op(1, OP_FILL, PART_START + 1, 3);
+	assert_int_equal(op_log[1].fill, 0xdeadbeef);
+	assert_op(2, OP_WRITE, PART_START + 4, 1);
+	assert_blocks(PART_START, 1, 0x11);
+	assert_pattern(PART_START + 1, 3, 0xdeadbeef);
+	assert_blocks(PART_START + 4, 1, 0x22);
+}
+
+static void test_fill_chunk_at_end(void **state)
+{
+	image_hdr(1);
+	chunk_fill(PART_BLOCKS, 0x12345678);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 1);
+	assert_op(0, OP_FILL, PART_START, PART_BLOCKS);
+	assert_pattern(PART_START, PART_BLOCKS, 0x12345678);
+}
+
+static void test_dont_care_chunk(void **state)
+{
+	image_hdr(3);
+	chunk_raw(1, 0x11);
+	chunk_dont_care(2);
+	chunk_raw(1, 0x22);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 2);
+	assert_op(0, OP_WRITE, PART_START, 1);
+	assert_op(1, OP_WRITE, PART_START + 3, 1);
+	assert_blocks(PART_START, 1, 0x11);
+	assert_blocks(PART_START + 1, 2, 0xee);
+	assert_blocks(PART_START + 3, 1, 0x22);
+}
+
+static void test_crc32_chunk(void **state)
+{
+	image_hdr(3);
+	chunk_raw(1, 0x11);
+	chunk_crc32(0xcafef00d);
+	chunk_raw(1, 0x22);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_blocks(PART_START, 1, 0x11);
+	assert_blocks(PART_START + 1, 1, 0x22);
+	assert_blocks(PART_START + 2, 1, 0xee);
+}
+
+/* One of each kind of chunk. */
+static void mixed_image(void)
+{
+	image_hdr(6);
+	chunk_raw(2, 0x11);
+	chunk_fill(1, 0xdeadbeef);
+	chunk_crc32(0xcafef00d);
+	chunk_dont_care(1);
+	chunk_raw(5, 0x22);
+	chunk_fill(2, 0x01020304);
+}
+
+static void test_split_chunk_headers(void **state)
+{
+	uint8_t expected[sizeof(disk_data)];
+
+	mixed_image();
+	assert_int_equal(write_image(image_len), 0);
+	memcpy(expected, disk_data, sizeof(expected));
+
+	/* Every header, fill value and CRC split at every possible point. */
+	for (size_t piece = 1; piece < sizeof(struct sparse_image_hdr) + 1;
+	     piece++) {
+		setup(state);
+		mixed_image();
+
+		assert_int_equal(write_image(piece), 0);
+		assert_memory_equal(disk_data, expected, sizeof(expected));
+	}
+
+	assert_blocks(PART_START, 2, 0x11);
+	assert_pattern(PART_START + 2, 1, 0xdeadbeef);
+	assert_blocks(PART_START + 3, 1, 0xee);
+	assert_blocks(PART_START + 4, 5, 0x22);
+	assert_pattern(PART_START + 9, 2, 0x01020304);
+}
+
+static void test_chunk_too_big(void **state)
+{
+	image_hdr(2);
+	chunk_raw(1, 0x11);
+	chunk_fill(PART_BLOCKS, 0);
+
+	assert_int_equal(write_image(image_len), -1);
+	assert_string_equal(writer.error, "Chunk too big");
+}
+
+static void test_bad_chunk_size(void **state)
+{
+	image_hdr(1);
+	chunk_hdr(CHUNK_TYPE_DONT_CARE, 1, sizeof(uint32_t));
+	image_add("\0\0\0\0", sizeof(uint32_t));
+
+	assert_int_equal(write_image(image_len), -1);
+	assert_string_equal(writer.error, "Chunk size is wrong");
+}
+
+static void test_unknown_chunk(void **state)
+{
+	image_hdr(1);
+	chunk_hdr(0xcac5, 1, 0);
+
+	assert_int_equal(write_image(image_len), -1);
+	assert_string_equal(writer.error, "Unrecognised chunk type");
+}
+
+static void test_image_ends_early(void **state)
+{
+	image_hdr(2);
+	chunk_raw(1, 0x11);
+	chunk_hdr(CHUNK_TYPE_RAW, 1, BLOCK_SIZE);
+
+	assert_int_equal(write_image(image_len), -1);
+	assert_string_equal(writer.error, "Sparse image ended abruptly");
+}
+
+static void test_data_after_last_chunk_ignored(void **state)
+{
+	image_hdr(1);
+	chunk_raw(1, 0x11);
+	image_add("trailing", 8);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 1);
+	assert_blocks(PART_START, 1, 0x11);
+	assert_blocks(PART_START + 1, 1, 0xee);
+}
+
+static void test_fill_runs_merged(void **state)
+{
+	image_hdr(5);
+	chunk_fill(2, 0x01010101);
+	chunk_crc32(0xcafef00d);
+	chunk_fill(3, 0x01010101);
+	chunk_fill(1, 0x02020202);
+	chunk_raw(1, 0x11);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 3);
+	assert_op(0, OP_FILL, PART_START, 5);
+	assert_int_equal(op_log[0].fill, 0x01010101);
+	assert_op(1, OP_FILL, PART_START + 5, 1);
+	assert_int_equal(op_log[1].fill, 0x02020202);
+	assert_op(2, OP_WRITE, PART_START + 6, 1);
+	assert_blocks(PART_START, 5, 0x01);
+	assert_blocks(PART_START + 5, 1, 0x02);
+	assert_blocks(PART_START + 6, 1, 0x11);
+}
+
+static void test_fill_runs_split_by_dont_care(void **state)
+{
+	image_hdr(3);
+	chunk_fill(2, 0x01010101);
+	chunk_dont_care(1);
+	chunk_fill(2, 0x01010101);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 2);
+	assert_op(0, OP_FILL, PART_START, 2);
+	assert_op(1, OP_FILL, PART_START + 3, 2);
+	assert_blocks(PART_START + 2, 1, 0xee);
+}
+
+static void test_zero_fill_erased(void **state)
+{
+	fake_disk.ops.erase = fake_erase;
+	fake_disk.erase_zeroes = 1;
+
+	image_hdr(3);
+	chunk_raw(1, 0x11);
+	chunk_fill(2, 0);
+	chunk_fill(3, 0);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 2);
+	assert_op(0, OP_WRITE, PART_START, 1);
+	assert_op(1, OP_ERASE, PART_START + 1, 5);
+	assert_blocks(PART_START + 1, 5, 0);
+}
+
+static void test_zero_fill_written_without_erase_zeroes(void **state)
+{
+	/* Erased blocks might read back as ones, say. */
+	fake_disk.ops.erase = fake_erase;
+
+	image_hdr(1);
+	chunk_fill(2, 0);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 1);
+	assert_op(0, OP_FILL, PART_START, 2);
+	assert_int_equal(op_log[0].fill, 0);
+	assert_blocks(PART_START, 2, 0);
+}
+
+static void test_zero_fill_written_if_erase_fails(void **state)
+{
+	fake_disk.ops.erase = fake_erase;
+	fake_disk.erase_zeroes = 1;
+	erase_fails = true;
+
+	image_hdr(1);
+	chunk_fill(2, 0);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 2);
+	assert_op(0, OP_ERASE, PART_START, 2);
+	assert_op(1, OP_FILL, PART_START, 2);
+	assert_blocks(PART_START, 2, 0);
+}
+
+static void test_dont_care_discard(void **state)
+{
+	fake_disk.ops.erase = fake_erase;
+	fake_disk.erase_zeroes = 1;
+
+	image_hdr(3);
+	chunk_raw(1, 0x11);
+	chunk_dont_care(2);
+	chunk_raw(1, 0x22);
+
+	assert_int_equal(write_image(image_len), 0);
+	if (CONFIG(FASTBOOT_SPARSE_DISCARD)) {
+		assert_int_equal(op_count, 3);
+		assert_op(1, OP_ERASE, PART_START + 1, 2);
+		assert_op(2, OP_WRITE, PART_START + 3, 1);
+	} else {
+		assert_int_equal(op_count, 2);
+		assert_op(1, OP_WRITE, PART_START + 3, 1);
+		assert_blocks(PART_START + 1, 2, 0xee);
+	}
+}
+
+static void test_dont_care_merged_with_zero_fill(void **state)
+{
+	fake_disk.ops.erase = fake_erase;
+	fake_disk.erase_zeroes = 1;
+
+	image_hdr(3);
+	chunk_fill(2, 0);
+	chunk_dont_care(2);
+	chunk_fill(1, 0);
+
+	assert_int_equal(write_image(image_len), 0);
+	if (CONFIG(FASTBOOT_SPARSE_DISCARD)) {
+		assert_int_equal(op_count, 1);
+		assert_op(0, OP_ERASE, PART_START, 5);
+	} else {
+		assert_int_equal(op_count, 2);
+		assert_op(0, OP_ERASE, PART_START, 2);
+		assert_op(1, OP_ERASE, PART_START + 4, 1);
+	}
+	assert_blocks(PART_START, 2, 0);
+	assert_blocks(PART_START + 4, 1, 0);
+}
+
+static void test_dont_care_erase_failure_ignored(void **state)
+{
+	fake_disk.ops.erase = fake_erase;
+	fake_disk.erase_zeroes = 1;
+	erase_fails = true;
+
+	image_hdr(2);
+	chunk_dont_care(2);
+	chunk_fill(1, 0);
+
+	assert_int_equal(write_image(image_len), 0);
+	if (CONFIG(FASTBOOT_SPARSE_DISCARD)) {
+		/* The zero fill still has to be written though. */
+		assert_int_equal(op_count, 2);
+		assert_op(0, OP_ERASE, PART_START, 3);
+		assert_op(1, OP_FILL, PART_START, 3);
+	} else {
+		assert_int_equal(op_count, 2);
+		assert_op(0, OP_ERASE, PART_START + 2, 1);
+		assert_op(1, OP_FILL, PART_START + 2, 1);
+		assert_blocks(PART_START, 2, 0xee);
+	}
+	assert_blocks(PART_START + 2, 1, 0);
+}
+
+static void test_dont_care_kept_without_erase(void **state)
+{
+	image_hdr(2);
+	chunk_dont_care(2);
+	chunk_raw(1, 0x11);
+
+	assert_int_equal(write_image(image_len), 0);
+	assert_int_equal(op_count, 1);
+	assert_op(0, OP_WRITE, PART_START + 2, 1);
+	assert_blocks(PART_START, 2, 0xee);
+}
+
+#define TEST(fn) cmocka_unit_test_setup(fn, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		TEST(test_raw_image),
+		TEST(test_raw_image_too_big),
+		TEST(test_raw_chunks_written_together),
+		TEST(test_fill_chunk),
+		TEST(test_fill_chunk_at_end),
+		TEST(test_dont_care_chunk),
+		TEST(test_crc32_chunk),
+		TEST(test_split_chunk_headers),
+		TEST(test_chunk_too_big),
+		TEST(test_bad_chunk_size),
+		TEST(test_unknown_chunk),
+		TEST(test_image_ends_early),
+		TEST(test_data_after_last_chunk_ignored),
+		TEST(test_fill_runs_merged),
+		TEST(test_fill_runs_split_by_dont_care),
+		TEST(test_zero_fill_erased),
+		TEST(test_zero_fill_written_without_erase_zeroes),
+		TEST(test_zero_fill_written_if_erase_fails),
+		TEST(test_dont_care_discard),
+		TEST(test_dont_care_merged_with_zero_fill),
+		TEST(test_dont_care_erase_failure_ignored),
+		TEST(test_dont_care_kept_without_erase),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+
+#include "tests/test.h"
+
+#include "net/uip.c"
+
+#define BUF_SIZE 2048
+
+static uint8_t buf[BUF_SIZE + 8];
+
+void net_call_callback(void)
+{
+}
+
+/* The original byte at a time implementation. */
+static uint16_t reference_chksum(uint16_t sum, const uint8_t *data,
+				 uint16_t len)
+{
+	uint16_t t;
+
+	for (; len >= 2; data += 2, len -= 2) {
+		t = (data[0] << 8) + data[1];
+		sum += t;
+		if (sum < t)
+			sum++;
+	}
+	if (len) {
+		t = data[0] << 8;
+		sum += t;
+		if (sum < t)
+			sum++;
+	}
+	return sum;
+}
+
+static uint32_t rand_state;
+
+static uint32_t test_rand(void)
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+static int setup(void **state)
+{
+	rand_state = 0x12345678;
+	return 0;
+}
+
+static void fill_random(void)
+{
+	for (int i = 0; i < sizeof(buf); i++)
+		buf[i] = test_rand();
+}
+
+static void check_all(uint16_t sum)
+{
+	for (int align = 0; align < 8; align++)
+		for (int len = 0; len <= BUF_SIZE; len++)
+			assert_int_equal(chksum(sum, buf + align, len),
+					 reference_chksum(sum, buf + align,
+							  len));
+}
+
+static void test_chksum_random(void **state)
+{
+	for (int i = 0; i < 4; i++) {
+		fill_random();
+		check_all(0);
+		check_all(test_rand());
+	}
+}
+
+static void test_chksum_zeroes(void **state)
+{
+	memset(buf, 0, sizeof(buf));
+	check_all(0);
+	check_all(0xffff);
+	check_all(0x1234);
+}
+
+static void test_chksum_ones(void **state)
+{
+	/* Every word overflows, so the end around carry matters. */
+	memset(buf, 0xff, sizeof(buf));
+	check_all(0);
+	check_all(0xffff);
+	check_all(1);
+}
+
+static void test_chksum_rfc1071(void **state)
+{
+	/* The worked example from RFC 1071. */
+	static const uint8_t data[] = {
+		0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7,
+	};
+
+	assert_int_equal(chksum(0, data, sizeof(data)), 0xddf2);
+}
+
+#define UIP_TEST(func) cmocka_unit_test_setup(func, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		UIP_TEST(test_chksum_random),
+		UIP_TEST(test_chksum_zeroes),
+		UIP_TEST(test_chksum_ones),
+		UIP_TEST(test_chksum_rfc1071),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
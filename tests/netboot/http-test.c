@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+
+#include "tests/test.h"
+
+#include "netboot/http.c"
+
+#define MAX_SIZE (16 * MiB)
+
+static uip_ipaddr_t server_ip;
+
+static int setup(void **state)
+{
+	uip_ipaddr(&server_ip, 192, 168, 0, 1);
+
+	memset(http_header, 0, sizeof(http_header));
+	http_max_size = MAX_SIZE;
+	http_offset = 0;
+	http_total_size = 0;
+	http_have_size = 0;
+	return 0;
+}
+
+/* Helpers */
+
+static int parse_url(const char *url, uip_ipaddr_t *ip, uint16_t *port,
+		     const char **path)
+{
+	char host[64];
+
+	return http_parse_url(url, &server_ip, ip, port, path, host,
+			      sizeof(host));
+}
+
+static void assert_bad_url(const char *url)
+{
+	uip_ipaddr_t ip;
+	uint16_t port;
+	const char *path;
+
+	assert_int_equal(parse_url(url, &ip, &port, &path), -1);
+}
+
+/* Header as http_recv() hands it over, ending after the last CRLF. */
+static int parse_header(const char *header)
+{
+	assert_true(strlen(header) < sizeof(http_header));
+	strcpy(http_header, header);
+	return http_parse_header();
+}
+
+/* Tests */
+
+static void test_url_ip_and_path(void **state)
+{
+	uip_ipaddr_t ip, expected;
+	uint16_t port;
+	const char *path;
+	char host[64];
+
+	assert_int_equal(http_parse_url("http://10.0.0.2/boot/vmlinuz",
+					&server_ip, &ip, &port, &path, host,
+					sizeof(host)), 0);
+	uip_ipaddr(&expected, 10, 0, 0, 2);
+	assert_true(uip_ipaddr_cmp(&ip, &expected));
+	assert_int_equal(port, HttpPort);
+	assert_string_equal(path, "/boot/vmlinuz");
+	assert_string_equal(host, "10.0.0.2");
+}
+
+static void test_url_port(void **state)
+{
+	uip_ipaddr_t ip;
+	uint16_t port;
+	const char *path;
+	char host[64];
+
+	assert_int_equal(http_parse_url("http://10.0.0.2:8080/vmlinuz",
+					&server_ip, &ip, &port, &path, host,
+					sizeof(host)), 0);
+	assert_int_equal(port, 8080);
+	assert_string_equal(path, "/vmlinuz");
+	assert_string_equal(host, "10.0.0.2:8080");
+
+	assert_int_equal(parse_url("http://10.0.0.2:65535/", &ip, &port,
+				   &path), 0);
+	assert_int_equal(port, 65535);
+}
+
+static void test_url_no_path(void **state)
+{
+	uip_ipaddr_t ip;
+	uint16_t port;
+	const char *path;
+
+	assert_int_equal(parse_url("http://10.0.0.2:81", &ip, &port, &path),
+			 0);
+	assert_int_equal(port, 81);
+	assert_string_equal(path, "/");
+}
+
+static void test_url_default_server(void **state)
+{
+	uip_ipaddr_t ip;
+	uint16_t port;
+	const char *path;
+	char host[64];
+
+	assert_int_equal(parse_url("http://:8080/vmlinuz", &ip, &port, &path),
+			 0);
+	assert_true(uip_ipaddr_cmp(&ip, &server_ip));
+	assert_int_equal(port, 8080);
+
+	assert_int_equal(http_parse_url("http:///vmlinuz", NULL, &ip, &port,
+					&path, host, sizeof(host)), -1);
+}
+
+static void test_url_bad_port(void **state)
+{
+	assert_bad_url("http://10.0.0.2:/vmlinuz");
+	assert_bad_url("http://10.0.0.2:0/vmlinuz");
+	assert_bad_url("http://10.0.0.2:65536/vmlinuz");
+	assert_bad_url("http://10.0.0.2:4294967377/vmlinuz");
+	assert_bad_url("http://10.0.0.2:80x/vmlinuz");
+	assert_bad_url("http://10.0.0.2: 80/vmlinuz");
+	assert_bad_url("http://10.0.0.2:-1/vmlinuz");
+	assert_bad_url("http://10.0.0.2:+80/vmlinuz");
+}
+
+static void test_url_bad_host(void **state)
+{
+	assert_bad_url("http://boot.example.com/vmlinuz");
+	assert_bad_url("http://10.0.0.2x/vmlinuz");
+	assert_bad_url("http://1234567890123456789/vmlinuz");
+	assert_bad_url("http://0000000000000000000000000000000000000000000000"
+		       "000000000000000000000/vmlinuz");
+}
+
+static void test_header_ok(void **state)
+{
+	assert_int_equal(parse_header("HTTP/1.1 200 OK\r\n"
+				      "Server: test\r\n"
+				      "content-length:\t1234\r\n"), 0);
+	assert_int_equal(http_total_size, 1234);
+	assert_int_equal(http_offset, 0);
+	assert_true(http_have_size);
+}
+
+static void test_header_ok_restarts_resume(void **state)
+{
+	http_offset = 100;
+	http_total_size = 1234;
+	http_have_size = 1;
+
+	/* The server ignored the range, so start again from the top. */
+	assert_int_equal(parse_header("HTTP/1.0 200 OK\r\n"
+				      "Content-Length: 1234\r\n"), 0);
+	assert_int_equal(http_offset, 0);
+}
+
+static void test_header_partial_content(void **state)
+{
+	http_offset = 100;
+	http_total_size = 1234;
+	http_have_size = 1;
+
+	assert_int_equal(parse_header("HTTP/1.1 206 Partial Content\r\n"
+				      "Content-Range: bytes 100-1233/1234\r\n"
+				      "Content-Length: 1134\r\n"), 0);
+	assert_int_equal(http_total_size, 1234);
+	assert_int_equal(http_offset, 100);
+}
+
+static void test_header_wrong_range(void **state)
+{
+	http_offset = 100;
+
+	assert_int_equal(parse_header("HTTP/1.1 206 Partial Content\r\n"
+				      "Content-Range: bytes 0-1233/1234\r\n"
+				      "Content-Length: 1234\r\n"), -1);
+	assert_int_equal(parse_header("HTTP/1.1 206 Partial Content\r\n"
+				      "Content-Range: bytes 100-1233/2000\r\n"
+				      "Content-Length: 1134\r\n"), -1);
+	assert_int_equal(parse_header("HTTP/1.1 206 Partial Content\r\n"
+				      "Content-Length: 1134\r\n"), -1);
+
+	/* Nothing was asked for, so a partial answer makes no sense. */
+	http_offset = 0;
+	assert_int_equal(parse_header("HTTP/1.1 206 Partial Content\r\n"
+				      "Content-Range: bytes 0-9/10\r\n"
+				      "Content-Length: 10\r\n"), -1);
+}
+
+static void test_header_error_status(void **state)
+{
+	assert_int_equal(parse_header("HTTP/1.1 404 Not Found\r\n"
+				      "Content-Length: 9\r\n"), -1);
+	assert_int_equal(parse_header("HTTP/1.1 abc Bad\r\n"
+				      "Content-Length: 9\r\n"), -1);
+	assert_int_equal(parse_header("HTTP/1.1 20\r\n"
+				      "Content-Length: 9\r\n"), -1);
+	assert_int_equal(parse_header("ICY 200 OK\r\n"
+				      "Content-Length: 9\r\n"), -1);
+}
+
+static void test_header_no_length(void **state)
+{
+	assert_int_equal(parse_header("HTTP/1.1 200 OK\r\n"
+				      "Content-Type: text/plain\r\n"), -1);
+	assert_false(http_have_size);
+}
+
+static void test_header_too_large(void **state)
+{
+	char header[128];
+
+	snprintf(header, sizeof(header),
+		 "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n", MAX_SIZE + 1);
+	assert_int_equal(parse_header(header), -1);
+}
+
+static void test_header_size_changed(void **state)
+{
+	http_total_size = 1234;
+	http_have_size = 1;
+
+	assert_int_equal(parse_header("HTTP/1.1 200 OK\r\n"
+				      "Content-Length: 1235\r\n"), -1);
+}
+
+static void test_header_transfer_encoding(void **state)
+{
+	assert_int_equal(parse_header("HTTP/1.1 200 OK\r\n"
+				      "Transfer-Encoding: chunked\r\n"
+				      "Content-Length: 9\r\n"), -1);
+	assert_int_equal(parse_header("HTTP/1.1 200 OK\r\n"
+				      "Transfer-Encoding: identity\r\n"
+				      "Content-Length: 9\r\n"), 0);
+}
+
+#define HTTP_TEST(func) cmocka_unit_test_setup(func, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		HTTP_TEST(test_url_ip_and_path),
+		HTTP_TEST(test_url_port),
+		HTTP_TEST(test_url_no_path),
+		HTTP_TEST(test_url_default_server),
+		HTTP_TEST(test_url_bad_port),
+		HTTP_TEST(test_url_bad_host),
+		HTTP_TEST(test_header_ok),
+		HTTP_TEST(test_header_ok_restarts_resume),
+		HTTP_TEST(test_header_partial_content),
+		HTTP_TEST(test_header_wrong_range),
+		HTTP_TEST(test_header_error_status),
+		HTTP_TEST(test_header_no_length),
+		HTTP_TEST(test_header_too_large),
+		HTTP_TEST(test_header_size_changed),
+		HTTP_TEST(test_header_transfer_encoding),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
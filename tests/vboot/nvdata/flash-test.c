@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <libpayload.h>
+
+#include "image/fmap.h"
+#include "tests/test.h"
+
+#include "vboot/nvdata/flash.c"
+
+#define BLOB_SIZE VB2_NVDATA_SIZE
+#define AREA_OFFSET 0x1000
+#define AREA_SIZE (8 * BLOB_SIZE)
+
+static uint8_t fake_flash[AREA_SIZE];
+static int read_count;
+static int erase_count;
+
+/* Mocks */
+
+const int fmap_find_area(const char *name, FmapArea *area)
+{
+	assert_string_equal(name, "RW_NVRAM");
+	area->offset = AREA_OFFSET;
+	area->size = AREA_SIZE;
+	return 0;
+}
+
+int flash_read(void *buffer, uint32_t offset, uint32_t size)
+{
+	assert_true(offset >= AREA_OFFSET);
+	assert_true(offset - AREA_OFFSET + size <= AREA_SIZE);
+	memcpy(buffer, fake_flash + offset - AREA_OFFSET, size);
+	read_count++;
+	return size;
+}
+
+/* Like NOR flash, writes can only clear bits. */
+int flash_write(const void *buffer, uint32_t offset, uint32_t size)
+{
+	const uint8_t *data = buffer;
+
+	assert_true(offset >= AREA_OFFSET);
+	assert_true(offset - AREA_OFFSET + size <= AREA_SIZE);
+	for (uint32_t i = 0; i < size; i++)
+		fake_flash[offset - AREA_OFFSET + i] &= data[i];
+	return size;
+}
+
+int flash_erase(uint32_t offset, uint32_t size)
+{
+	assert_int_equal(offset, AREA_OFFSET);
+	assert_int_equal(size, AREA_SIZE);
+	memset(fake_flash, 0xff, sizeof(fake_flash));
+	erase_count++;
+	return size;
+}
+
+static int setup(void **state)
+{
+	memset(fake_flash, 0xff, sizeof(fake_flash));
+	nvdata_flash_is_initialized = 0;
+	read_count = 0;
+	erase_count = 0;
+	return 0;
+}
+
+/* Test functions */
+
+static void test_init_empty(void **state)
+{
+	uint8_t buf[BLOB_SIZE];
+	uint8_t expected[BLOB_SIZE];
+
+	memset(expected, 0xff, sizeof(expected));
+	assert_int_equal(nvdata_flash_read(buf), VB2_SUCCESS);
+	assert_memory_equal(buf, expected, BLOB_SIZE);
+	assert_int_equal(nvdata_flash_get_offset(), 0);
+	assert_int_equal(read_count, 1);
+}
+
+static void test_init_finds_last_blob(void **state)
+{
+	uint8_t buf[BLOB_SIZE];
+
+	for (int used = 1; used <= AREA_SIZE / BLOB_SIZE; used++) {
+		setup(state);
+		for (int i = 0; i < used; i++)
+			memset(fake_flash + i * BLOB_SIZE, i, BLOB_SIZE);
+		assert_int_equal(nvdata_flash_read(buf), VB2_SUCCESS);
+		assert_int_equal(nvdata_flash_get_offset(),
+				 (used - 1) * BLOB_SIZE);
+		assert_int_equal(buf[0], used - 1);
+		assert_int_equal(read_count, 1);
+	}
+}
+
+static void test_init_mostly_erased_blob(void **state)
+{
+	uint8_t buf[BLOB_SIZE];
+
+	/* Only the last byte of the third blob has been programmed. */
+	fake_flash[3 * BLOB_SIZE - 1] = 0x5a;
+	assert_int_equal(nvdata_flash_read(buf), VB2_SUCCESS);
+	assert_int_equal(nvdata_flash_get_offset(), 2 * BLOB_SIZE);
+	assert_int_equal(buf[BLOB_SIZE - 1], 0x5a);
+}
+
+static void test_write_appends_until_full(void **state)
+{
+	uint8_t buf[BLOB_SIZE];
+
+	for (int i = 0; i < AREA_SIZE / BLOB_SIZE; i++) {
+		memset(buf, 0x55 + (i & 1) * 0x55, sizeof(buf));
+		assert_int_equal(nvdata_flash_write(buf), VB2_SUCCESS);
+		assert_int_equal(nvdata_flash_get_offset(), i * BLOB_SIZE);
+		assert_memory_equal(fake_flash + i * BLOB_SIZE, buf,
+				    BLOB_SIZE);
+	}
+	assert_int_equal(erase_count, 0);
+
+	/* The area is full, so the next new blob needs an erase. */
+	memset(buf, 0x55, sizeof(buf));
+	assert_int_equal(nvdata_flash_write(buf), VB2_SUCCESS);
+	assert_int_equal(erase_count, 1);
+	assert_int_equal(nvdata_flash_get_offset(), 0);
+	assert_memory_equal(fake_flash, buf, BLOB_SIZE);
+	assert_int_equal(fake_flash[BLOB_SIZE], 0xff);
+
+	/* A fresh init finds the same blob. */
+	nvdata_flash_is_initialized = 0;
+	memset(buf, 0, sizeof(buf));
+	assert_int_equal(nvdata_flash_read(buf), VB2_SUCCESS);
+	assert_int_equal(nvdata_flash_get_offset(), 0);
+	assert_int_equal(buf[0], 0x55);
+}
+
+static void test_write_clears_bits_in_place(void **state)
+{
+	uint8_t buf[BLOB_SIZE];
+
+	memset(buf, 0xf0, sizeof(buf));
+	assert_int_equal(nvdata_flash_write(buf), VB2_SUCCESS);
+	memset(buf, 0x30, sizeof(buf));
+	assert_int_equal(nvdata_flash_write(buf), VB2_SUCCESS);
+	assert_int_equal(nvdata_flash_get_offset(), 0);
+	assert_memory_equal(fake_flash, buf, BLOB_SIZE);
+	assert_int_equal(fake_flash[BLOB_SIZE], 0xff);
+}
+
+#define NVDATA_TEST(func) cmocka_unit_test_setup(func, setup)
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		NVDATA_TEST(test_init_empty),
+		NVDATA_TEST(test_init_finds_last_blob),
+		NVDATA_TEST(test_init_mostly_erased_blob),
+		NVDATA_TEST(test_write_appends_until_full),
+		NVDATA_TEST(test_write_clears_bits_in_place),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}